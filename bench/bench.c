@@ -0,0 +1,337 @@
+/*
+
+  bench.c: timing the core kernels
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Time each kernel for genomes of 2 up to MAXLOCI loci and a few
+   recombination fractions, and print one tab-separated line per
+   kernel, genome size and r:
+
+   kernel nloci geno r reps ns_per_call nnz table_bytes maxrss_kb
+
+   NNZ and TABLE_BYTES describe the recombination table the kernel
+   reads, as counted by mem_usage () (NA for kernels that do not use
+   one); MAXRSS_KB is the peak resident size of the process so far.
+   With up to REC_FIXED_MAXLOCI loci, rec_mating runs the kernels of
+   fixed.c, which walk the recombination map; the linked table is
+   timed by sparse_mat_tot.  Each kernel is repeated for at least
+   MINTIME seconds.  Costs grow quickly with the number of loci, so a kernel
+   whose single call takes longer than the budget (-t seconds), or
+   whose table or mating table would exceed the memory cap (-m
+   megabytes), is not run for larger genomes.
+
+   Usage: bench [-n maxloci] [-t budget] [-m megabytes] > results.tsv
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "../src/haploid.h"
+#include "../src/sparse.h"
+
+#define MINLOCI 2
+#define MAXLOCI 14
+#define MINTIME 0.05
+#define NR 4
+
+static const double rvals[NR] = { 0.5, 0.1, 0.01, 0.0 };
+
+/* the kernels, in the order they are printed */
+enum
+  {
+    K_A2G, K_G2A, K_LD, K_LDSUB, K_LDALL, K_RMTABLE, K_TABLE, K_MATTOT,
+    K_MATING, K_PACKED, K_GENERATION, NKERNELS
+  };
+static const char * names[NKERNELS] =
+  {
+    "allele_to_genotype", "genotype_to_allele", "ld_from_geno",
+    "ld_sub_geno", "ld_all_geno", "rmtable", "rec_gen_table",
+    "sparse_mat_tot", "rec_mating", "rec_mating_packed", "generation"
+  };
+
+/* the state the kernels work on */
+typedef struct
+{
+  size_t nloci;
+  size_t geno;
+  double * freqs;
+  double * alleles;
+  double * alleles0;		/* the starting alleles, kept apart */
+  double * ld;
+  double * W;
+  double * r;
+  haploid_data_t data;
+} bench_t;
+
+static double
+bench_now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static long
+bench_maxrss (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static void
+bench_free_mtable (double ** mtable, size_t geno)
+{
+  for (size_t i = 0; i < geno; i++)
+    free (mtable[i]);
+  free (mtable);
+}
+
+static void
+bench_call (bench_t * b, int kernel)
+{
+  /* one call of KERNEL */
+  size_t geno = b->geno;
+  switch (kernel)
+    {
+    case K_A2G:
+      allele_to_genotype (b->alleles, b->freqs, b->nloci, geno);
+      break;
+    case K_G2A:
+      genotype_to_allele (b->alleles, b->freqs, b->nloci, geno);
+      break;
+    case K_LD:
+      b->ld[0] = ld_from_geno (b->freqs, geno);
+      break;
+    case K_LDSUB:
+      b->ld[0] = ld_sub_geno (b->freqs, geno - 1, geno);
+      break;
+    case K_LDALL:
+      ld_all_geno (b->freqs, b->ld, geno);
+      break;
+    case K_RMTABLE:
+      bench_free_mtable (rmtable (b->freqs, geno), geno);
+      break;
+    case K_TABLE:
+      rec_free_table (rec_gen_table (b->r, geno), geno);
+      break;
+    case K_MATTOT:
+      for (size_t k = 0; k < geno; k++)
+	b->ld[k] = sparse_mat_tot (geno, b->data.mtable,
+				   b->data.rec_table[k]);
+      break;
+    case K_MATING:
+    case K_PACKED:
+      /* the same parents every time */
+      rec_mating (b->ld, &b->data);
+      break;
+    case K_GENERATION:
+      {
+	double wbar = 0.0;
+	for (size_t i = 0; i < geno; i++)
+	  wbar += b->freqs[i] * b->W[i];
+	for (size_t i = 0; i < geno; i++)
+	  b->freqs[i] *= b->W[i] / wbar;
+	double ** mtable = b->data.mtable;
+	b->data.mtable = rmtable (b->freqs, geno);
+	rec_mating (b->freqs, &b->data);
+	bench_free_mtable (b->data.mtable, geno);
+	b->data.mtable = mtable;
+	genotype_to_allele (b->alleles, b->freqs, b->nloci, geno);
+      }
+      break;
+    }
+}
+
+static double
+bench_time (bench_t * b, int kernel, size_t * reps)
+{
+  /* seconds per call of KERNEL, over at least MINTIME seconds */
+  size_t n = 0;
+  double start = bench_now (), elapsed;
+  do
+    {
+      bench_call (b, kernel);
+      n++;
+      elapsed = bench_now () - start;
+    }
+  while (elapsed < MINTIME);
+  *reps = n;
+  return elapsed / n;
+}
+
+static void
+bench_print (int kernel, bench_t * b, double r, size_t reps, double t,
+	     _Bool table, size_t nnz, size_t bytes)
+{
+  printf ("%s\t%zu\t%zu\t", names[kernel], b->nloci, b->geno);
+  if (isnan (r))
+    printf ("NA\t");
+  else
+    printf ("%g\t", r);
+  printf ("%zu\t%.1f\t", reps, t * 1e9);
+  if (table)
+    printf ("%zu\t%zu\t", nnz, bytes);
+  else
+    printf ("NA\tNA\t");
+  printf ("%ld\n", bench_maxrss ());
+  fflush (stdout);
+}
+
+int
+main (int argc, char ** argv)
+{
+  size_t maxloci = MAXLOCI;
+  double budget = 10.0;
+  double cap = 1024.0;
+  int opt;
+  while ((opt = getopt (argc, argv, "n:t:m:")) != -1)
+    switch (opt)
+      {
+      case 'n':
+	maxloci = strtoul (optarg, NULL, 10);
+	break;
+      case 't':
+	budget = strtod (optarg, NULL);
+	break;
+      case 'm':
+	cap = strtod (optarg, NULL);
+	break;
+      default:
+	fprintf (stderr, "Usage: %s [-n maxloci] [-t seconds] [-m MB]\n",
+		 argv[0]);
+	return EXIT_FAILURE;
+      }
+  cap *= 1024.0 * 1024.0;
+
+  /* kernels that have exceeded the budget */
+  _Bool over[NKERNELS] = { false };
+  haploid_rng_t rng;
+  rng_init (&rng, 1, 0, 0, 0);
+
+  printf ("kernel\tnloci\tgeno\tr\treps\tns_per_call\tnnz\ttable_bytes"
+	  "\tmaxrss_kb\n");
+  for (size_t nloci = MINLOCI; nloci <= maxloci; nloci++)
+    {
+      bench_t b;
+      size_t geno = (size_t) 1 << nloci;
+      b.nloci = nloci;
+      b.geno = geno;
+      b.freqs = malloc (geno * sizeof (double));
+      b.alleles = malloc (nloci * sizeof (double));
+      b.alleles0 = malloc (nloci * sizeof (double));
+      b.ld = malloc (geno * sizeof (double));
+      b.W = malloc (geno * sizeof (double));
+      b.r = malloc (nloci * sizeof (double));
+      if ((b.freqs == NULL) || (b.alleles == NULL) || (b.alleles0 == NULL)
+	  || (b.ld == NULL) || (b.W == NULL) || (b.r == NULL))
+	error (EXIT_FAILURE, ENOMEM, "Null pointer");
+      for (size_t j = 0; j < nloci; j++)
+	b.alleles0[j] = b.alleles[j] = 0.1 + 0.8 * rng_uniform (&rng);
+      for (size_t i = 0; i < geno; i++)
+	b.W[i] = 1.0 + 0.1 * rng_uniform (&rng);
+      allele_to_genotype (b.alleles, b.freqs, nloci, geno);
+
+      /* kernels without a recombination table */
+      for (int k = K_A2G; k <= K_RMTABLE; k++)
+	{
+	  if (over[k]
+	      || ((k == K_RMTABLE) && (geno * geno * sizeof (double) > cap)))
+	    continue;
+	  size_t reps;
+	  double t = bench_time (&b, k, &reps);
+	  over[k] = (t > budget);
+	  bench_print (k, &b, NAN, reps, t, false, 0, 0);
+	}
+
+      for (int ri = 0; (ri < NR) && !over[K_TABLE]; ri++)
+	{
+	  for (size_t j = 0; j < nloci; j++)
+	    b.r[j] = rvals[ri];
+	  /* tables without recombination are much smaller */
+	  haploid_mem_t mem;
+	  mem_estimate (nloci, b.r, &mem);
+	  if (mem.list + mem.mtable > cap)
+	    continue;
+	  double start = bench_now ();
+	  b.data.geno = geno;
+	  b.data.nloci = nloci;
+	  b.data.rec_table = rec_gen_table (b.r, geno);
+	  b.data.rec_fixed = NULL;
+	  b.data.mtable = NULL;
+	  b.data.rec_lazy = NULL;
+	  b.data.rec_packed = NULL;
+	  double t = bench_now () - start;
+	  mem_usage (&b.data, &mem);
+	  size_t nnz = mem.nnz;
+	  size_t bytes = mem.list;
+	  bench_print (K_TABLE, &b, rvals[ri], 1, t, true, nnz, bytes);
+	  over[K_TABLE] = over[K_TABLE] || (t > budget);
+	  b.data.mtable = rmtable (b.freqs, geno);
+
+	  for (int k = K_MATTOT; k < NKERNELS; k++)
+	    {
+	      if (over[k])
+		continue;
+	      if (k == K_PACKED)
+		{
+		  b.data.rec_packed = rec_packed_table (b.data.rec_table, geno);
+		  if (b.data.rec_packed == NULL)
+		    continue;
+		}
+	      /* the size of the table the kernel reads */
+	      mem_usage (&b.data, &mem);
+	      size_t kbytes = (k == K_PACKED) ? mem.packed : bytes;
+	      size_t reps;
+	      t = bench_time (&b, k, &reps);
+	      over[k] = over[k] || (t > budget);
+	      bench_print (k, &b, rvals[ri], reps, t, true, nnz, kbytes);
+	      rec_packed_free (b.data.rec_packed);
+	      b.data.rec_packed = NULL;
+	      /* the generation kernel moves the frequencies and the
+		 alleles; start again from the first ones */
+	      memcpy (b.alleles, b.alleles0, nloci * sizeof (double));
+	      allele_to_genotype (b.alleles, b.freqs, nloci, geno);
+	    }
+	  bench_free_mtable (b.data.mtable, geno);
+	  rec_free_table (b.data.rec_table, geno);
+	}
+      free (b.freqs);
+      free (b.alleles);
+      free (b.alleles0);
+      free (b.ld);
+      free (b.W);
+      free (b.r);
+    }
+  return 0;
+}
+/* end of bench.c */
@@ -32,150 +32,103 @@
 #include <error.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
-#include <limits.h>
+#include <inttypes.h>
+#include <unistd.h>
 #include <assert.h>
 
 #define GENO 4
 #define TRIALS 256
-#define MAXBUF 163840
 static const double err = 0.1;
 static const size_t nloci = 2;
 static const size_t geno = GENO;
-char prec[] = "%-#9.8f ";
+/* output is printed as "%-#9.8f " */
+#define WIDTH 9
+#define PREC 8
 
 
-char *
-nrm_iterate (double * freqs, haploid_data_t * data);
+void
+nrm_mating (double ** mtable, const double * freqs, size_t geno, void * arg);
+
+void
+nrm_print (const haploid_sim_t * sim, void * arg);
 
 int
 main (void)
 {
   double r = 0.25;
-  srand48 (time (0));
+  /* record the seed: setting HAPLOID_SEED to it repeats the run */
+  uint64_t seed = rng_seed ();
+  fprintf (stderr, "seed %" PRIu64 "\n", seed);
+  haploid_writer_t * out = writer_new (STDOUT_FILENO, 0);
+  /* the recombination tables, shared by every trial */
+  haploid_model_t * model = model_new (nloci, &r);
 
   for (int i = 0; i < TRIALS; i++)
     {
-      haploid_data_t * nrm_data = malloc (sizeof (haploid_data_t));
-      if (nrm_data == NULL)
-	error (ENOMEM, ENOMEM, "Null pointer");
-  
-      /* populate the structure */
-      nrm_data->geno = geno;
-      nrm_data->nloci = nloci;
-      nrm_data->rec_table = rec_gen_table (&r, geno);
-  
-      /* generate an assortative mating table: */
-      double ** mtable = malloc (geno * sizeof (double *));
-      if (mtable == NULL)
-	error (ENOMEM, ENOMEM, "Null pointer");
-      for (int j = 0; j < geno; j++)
-	{
-	  mtable[j] = malloc (geno * sizeof (double));
-	  if (mtable[j] == NULL)
-	    error (ENOMEM, ENOMEM, "Null pointer");
- 
-	}
-      nrm_data->mtable = mtable;
       /* generate some frequencies */
       double freqs[geno];
       double alleles[nloci];
+      haploid_rng_t rng;
+      rng_init (&rng, seed, 0, i, 0);
       for (int j = 0; j < nloci; j++)
-	alleles[j] = drand48 ();
+	alleles[j] = rng_uniform (&rng);
       /* transfer alleles to genotypes through one generation of random
 	 mating */
       allele_to_genotype (alleles, freqs, nloci, geno);
-      /* print genotype frequencies and LD */
-      char * output;
-      output = nrm_iterate (freqs, nrm_data);
-
-      fprintf (stdout, output);
-      free (output);
+      /* run to the end, printing genotype frequencies and LD */
+      haploid_sim_t * sim = sim_new (model, freqs, NULL, 1e-9);
+      /* stop only when the frequencies stop changing */
+      sim->fixed = 0.0;
+      sim->mating = nrm_mating;
+      sim->observe = nrm_print;
+      sim->arg = out;
+      sim_run_for (sim, 0, 0.0);
+      sim_free (sim);
+      /* add a couple of newlines at the end */
+      writer_str (out, "\n\n");
     }
+  model_unref (model);
+  if (writer_free (out) != 0)
+    error (EXIT_FAILURE, errno, "Failed write");
   return 0;
 }
 
-char *
-nrm_iterate (double * freqs, haploid_data_t * data)
+void
+nrm_mating (double ** mtable, const double * freqs, size_t geno, void * arg)
 {
-  /* run the simulation: return a buffer of output data */
-  /* unpack the data: */
-  size_t geno = data->geno;
-  size_t nloci = data->nloci;
-  double ** mtable = data->mtable;
-  /* eventually we should have total assortative mating */
-  double old[geno];
-
+  /* an assortative mating table: eventually we should have total
+     assortative mating */
+  double denom = 0.0F;
   /* how much to distort mating probability: */
   double factor;
+  for (int j = 0; j < geno; j++)
+    for (int i = 0; i < geno; i++)
+      {
+	if (i == j)
+	  factor = 1.0 - err;
+	else
+	  factor = err;
+	      
+	mtable[i][j] = (freqs[i]*freqs[j]) * factor;
+	denom += mtable[i][j];
+      }
+  assert (isgreater (denom, 0));
+  for (int i = 0; i < geno; i++)
+    for (int j = 0; j < geno; j++)
+      mtable[i][j] /= denom;
+}
 
-  /* the size of the output buffer (return value of this function) */
-  size_t remain = MAXBUF * CHAR_BIT;
-  /* the return value (a buffer) */
-  char * finstr = malloc (remain);
-  if (finstr == NULL)
-    error (ENOMEM, ENOMEM, "Null pointer");
-  /* point to this so we can print at the right spot in the buffer */
-  char * dest = finstr;
-  /* keep a running total so we can realloc at the end */
-  size_t snck = 0;
-  size_t rtot = 0;
-
-  /* do it! */
-  do
+void
+nrm_print (const haploid_sim_t * sim, void * arg)
+{
+  /* print the genotype frequencies and LD of a generation */
+  haploid_writer_t * out = arg;
+  double * freqs = sim->pop->freqs;
+  for (int j = 0; j < geno; j++)
     {
-      double denom = 0.0F;
-
-      for (int j = 0; j < geno; j++)
-	{
-	  /* save old frequencies */
-	  old[j] = freqs[j];
-	  /* adjust mating table */
-	  for (int i = 0; i < geno; i++)
-	    {
-	      if (i == j)
-		factor = 1.0 - err;
-	      else
-		factor = err;
-	      
-	      mtable[i][j] = (freqs[i]*freqs[j]) * factor;
-	      denom += mtable[i][j];
-	    }
-	}
-      
-      assert (isgreater (denom, 0));
-      for (int i = 0; i < geno; i++)
-	for (int j = 0; j < geno; j++)
-	  mtable[i][j] /= denom;
-      /* mating */
-      rec_mating (freqs, data);
-
-      /* print the genotype frequencies: */
-      for (int j = 0; j < geno; j++,
-	     dest += snck,
-	     remain -= snck,
-	     rtot += snck)
-	{
-	  snck = snprintf (dest, remain, prec, freqs[j]);
-	  if (snck > remain)
-	    /* abort */
-	    error (ENOMEM, ENOMEM,
-		   "Failed write to buffer by %zu bytes", remain - snck);
-	}
-
-      /* print LD and a newline */    
-      snck = snprintf (dest, remain, "%-#9.8f\n",
-		       ld_from_geno (freqs, geno));
-      dest += snck;
-      remain -= snck;
-      rtot += snck;
-    } while (sim_stop_ck (old, freqs, geno, 1e-9));
-
-  /* add a couple of newlines at the end */
-  snprintf (dest, remain, "\n\n");
-  dest += 2;
-  remain -= 2;
-  rtot += snck + 1;		/* don't forget the \0! */
-
-  return realloc (finstr, rtot);
+      writer_fixed (out, freqs[j], WIDTH, PREC, true);
+      writer_char (out, ' ');
+    }
+  writer_fixed (out, ld_from_geno (freqs, geno), WIDTH, PREC, true);
+  writer_char (out, '\n');
 }
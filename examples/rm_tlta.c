@@ -32,33 +32,32 @@
 #include "../src/haploid.h"
 #include <stdio.h>
 #include <error.h>
-#include <time.h>
-#include <limits.h>
+#include <inttypes.h>
+#include <unistd.h>
 
 #define NLOCI 2
 #define GENO 4
 #define TRIALS 256
-#define MAXBUF 163840
 
-static const char prec[] = "%-#9.8f ";
-static const char precn[] = "%-#9.8f \n";
+/* output is printed as "%-#9.8f " */
+#define WIDTH 9
+#define PREC 8
 
 double r =  0.25;
 
-char *
-rm_iterate (haploid_data_t * rm_data, double * alleles, double D);
+void
+rm_iterate (haploid_model_t * model, double * alleles, double D,
+	    haploid_writer_t * out);
 
 int
 main (void)
 {
-  /* a few prelims: */
-  haploid_data_t * rm_data = malloc (sizeof (haploid_data_t));
-  if (rm_data == NULL)
-    error (ENOMEM, ENOMEM, "Null pointer");
-  rm_data->rec_table = rec_gen_table (&r, GENO);
-  rm_data->geno = GENO;
-  rm_data->nloci = NLOCI;
-  srand48 (time (0));
+  /* a few prelims: the tables, shared by every trial */
+  haploid_model_t * model = model_new (NLOCI, &r);
+  /* record the seed: setting HAPLOID_SEED to it repeats the run */
+  uint64_t seed = rng_seed ();
+  fprintf (stderr, "seed %" PRIu64 "\n", seed);
+  haploid_writer_t * out = writer_new (STDOUT_FILENO, 0);
 
   for (int i = 0; i < TRIALS; i++)
     {
@@ -67,33 +66,26 @@ main (void)
       for (int j = 0; j < NLOCI; j++)
 	allele[j] = 0.1;
       double D;
+      haploid_rng_t rng;
+      rng_init (&rng, seed, 0, i, 0);
       if (i == 0)
 	D = 0;
       else
-	D = drand48 () / 10.0F;
+	D = rng_uniform (&rng) / 10.0F;
 
-      char * output = rm_iterate (rm_data, allele, D);
-
-      {
-	fprintf (stdout, output);
-	free (output);
-	fprintf (stdout, "\n");
-      }
+      rm_iterate (model, allele, D, out);
+      writer_char (out, '\n');
     }
+  model_unref (model);
+  if (writer_free (out) != 0)
+    error (EXIT_FAILURE, errno, "Failed write");
   return 0;
 }
 
-char *
-rm_iterate (haploid_data_t * rm_data, double * alleles, double D)
+void
+rm_iterate (haploid_model_t * model, double * alleles, double D,
+	    haploid_writer_t * out)
 {
-  size_t remain = MAXBUF * CHAR_BIT;
-  char * output = malloc (remain);
-  if (output == NULL)
-    error (ENOMEM, ENOMEM, "Null pointer");
-  char * dest = output;
-  int snck;
-  size_t rtot = 0;
-
   double genotypes[GENO];
   double old[GENO];
 
@@ -107,38 +99,24 @@ rm_iterate (haploid_data_t * rm_data, double * alleles, double D)
 	eta = -1;
       genotypes[j] += eta * D;
     }
+  haploid_pop_t * pop = pop_new (model, genotypes);
   
   do
     {
       for (int j = 0; j < GENO; j++)
-	old[j] = genotypes[j];
+	old[j] = pop->freqs[j];
       
-      rm_data->mtable = rmtable (GENO, genotypes);
-      rec_mating (genotypes, rm_data);
-      for (int j = 0; j < GENO; j++,
-	     dest += snck,
-	     remain -= snck,
-	     rtot += snck)
+      pop_generation (pop, NULL);
+      for (int j = 0; j < GENO; j++)
 	{
-	  snck = snprintf (dest, remain, prec, genotypes[j]);
-	  if (snck > remain)
-	    /* abort */
-	    error (ENOMEM, ENOMEM,
-		   "Failed write to buffer by %zu bytes", remain - snck);
+	  writer_fixed (out, pop->freqs[j], WIDTH, PREC, true);
+	  writer_char (out, ' ');
 	}
-      snck = snprintf (dest, remain, prec,
-		       ld_from_geno (genotypes, GENO));
-      remain += snck;
-      rtot   += snck;
-      remain -= snck;
-      dest   += snck;
+      writer_fixed (out, ld_from_geno (pop->freqs, GENO), WIDTH, PREC, true);
+      writer_char (out, ' ');
       D	     *= (1 - r);
-      snck    = snprintf (dest, remain, precn, D);		       
-      remain += snck;
-      rtot   += snck;
-      remain -= snck;
-      dest   += snck;
-    } while (sim_stop_ck (old, genotypes, GENO, 1e-9));
-  
-  return realloc (output, rtot);
+      writer_fixed (out, D, WIDTH, PREC, true);
+      writer_str (out, " \n");
+    } while (sim_stop_ck (old, pop->freqs, GENO, 1e-9));
+  pop_free (pop);
 }
@@ -38,16 +38,18 @@
 #ifndef R
 #define R 0.5F
 #endif
-#define MAXBUF 256
 
 /* includes */
 #include <stdio.h>
 #include "../src/haploid.h"
 #include "../src/sparse.h"
 #include <string.h>
-#include <time.h>
+#include <unistd.h>
+#include <inttypes.h>
 
-char prec[] = "%9.8f ";
+/* frequencies are printed as "%9.8f " */
+#define WIDTH 9
+#define PREC 8
 
 void
 selection (double * freqs, double * W);
@@ -55,6 +57,9 @@ selection (double * freqs, double * W);
 void
 rec_test_prtable (haploid_data_t * data);
 
+void
+tlta_print (haploid_writer_t * out, double * allele);
+
 
 int
 main (void)
@@ -69,23 +74,34 @@ main (void)
   /* initialize recombination table: */
   double rprob = 0.25;
   rtable_t ** rtable =  rec_gen_table(&rprob, GENO);
+  /* the mating table of each generation is made in place */
+  haploid_ws_t * ws = ws_new (NLOCI);
  
+  /* record the seed: setting HAPLOID_SEED to it repeats the run */
+  uint64_t seed = rng_seed ();
+  fprintf (stderr, "seed %" PRIu64 "\n", seed);
+  haploid_writer_t * out = writer_new (STDOUT_FILENO, 0);
+#ifdef ENSEMBLE
+  /* the final allele frequencies and the time to fixation */
+  double lo[NLOCI + 1] = { 0.0 }, hi[NLOCI + 1];
+  for (int j = 0; j < NLOCI; j++)
+    hi[j] = 1.0;
+  hi[NLOCI] = 1000.0;
+  ens_t * ens = ens_new (NLOCI + 1, 100, lo, hi);
+#endif  /* ENSEMBLE */
+
   for (int i = 0; i < TRIALS; i++)
     {
-      size_t snck;
-      size_t remain = MAXBUF;
-      char outstr[MAXBUF];
-      char * dest = outstr;
-      
       double allele[NLOCI];
       haploid_data_t tlta_data = {GENO, NLOCI, rtable};
-      srand48 (time (0));
+      haploid_rng_t rng;
+      rng_init (&rng, seed, 0, i, 0);
       if (i < GENO)
 	for (int j = 0; j < NLOCI; j++)
 	  allele[j] = (double)bits_isset (i, j);
       else
 	for (int j = 0; j < NLOCI; j++)
-	  allele[j] = drand48 ();
+	  allele[j] = rng_uniform (&rng);
 
       double freq[GENO];
       
@@ -94,26 +110,8 @@ main (void)
 
       
 	/* first print the allele frequencies */
-	snck = snprintf (outstr, remain, "Trial %i\n", i);
-	if (snck > remain)
-	  /* abort */
-	  error (ENOMEM, ENOMEM,
-		 "Failed write to buffer by %zu bytes", remain - snck);
-	dest += snck;
-	remain -= snck;
-	for (int j = 0; j < NLOCI; j++,
-	       dest += snck,
-	       remain -= snck)
-	  {
-	    snck = snprintf (dest, remain, prec, allele[j]);
-	    if (snck > remain)
-	      /* abort */
-	      error (ENOMEM, ENOMEM,
-		     "Failed write to buffer by %zu bytes", remain - snck);
-	  }
-	snprintf (dest, remain, "\n");
-	dest += 1;
-	remain -= 1;
+	writer_printf (out, "Trial %i\n", i);
+	tlta_print (out, allele);
 	
 	/* while sim_stop_ck returns 1 and we are at less than a million
 	   generations, keep going, baby */
@@ -122,29 +120,14 @@ main (void)
 	{
 	  /* produce the next generation */
 	  selection (freq, W);
-	  tlta_data.mtable = rmtable (GENO,  freq);
+	  tlta_data.mtable = rmtable_ws (freq, ws);
 	  rec_mating (freq, &tlta_data);
 	  	  
 	  /* generate new allele frequencies: */
 	  genotype_to_allele (allele, freq, NLOCI, GENO);
 #ifdef PRFREQS
 	  if (i > 3)
-	    {
-	      for (int j = 0; j < NLOCI; j++,
-		     dest += snck,
-		     remain -= snck)
-		{
-		  snck = snprintf (dest, remain, prec, allele[j]);
-		  if (snck > remain)
-		    /* abort */
-		    error (ENOMEM, ENOMEM,
-			   "Failed write to buffer by %d bytes", remain - snck);
-		}
-	      snprintf (dest, remain, "\n", remain - snck);
-	      dest += 1;
-	      remain -= 1;
-
-	    }
+	    tlta_print (out, allele);
 #endif  /* PRFREQS */
 	  /* we expect something to fix or be lost */
 	  if (!sim_stop_ck (allele, goal, NLOCI, 1e-8))
@@ -154,24 +137,38 @@ main (void)
 	}
       
       /* print the final frequencies */
-      for (int j = 0; j < NLOCI; j++,
-	     dest += snck,
-	     remain -= snck)
-	{
-	  snck = snprintf (dest, remain, prec, allele[j]);
-	  if (snck > remain)
-	    /* abort */
-	    error (ENOMEM, ENOMEM,
-		   "Failed write to buffer by %zu bytes", remain - snck);
-	}
-      snprintf (dest, remain, "\n");
-      dest += 1;
-      remain -= 1;
+      tlta_print (out, allele);
+      writer_char (out, '\n');
+#ifdef ENSEMBLE
       {
-	fprintf (stdout, outstr);
-	fprintf (stdout, "\n");
+	double stats[NLOCI + 1];
+	for (int j = 0; j < NLOCI; j++)
+	  stats[j] = allele[j];
+	stats[NLOCI] = (n < GENS) ? n : NAN;
+	ens_add (ens, stats);
       }
+#endif  /* ENSEMBLE */
     }
+#ifdef ENSEMBLE
+  /* summarize the trials: mean, standard deviation and quartiles */
+  writer_str (out, "Ensemble\n");
+  for (int j = 0; j <= NLOCI; j++)
+    {
+      writer_fixed (out, ens_mean (ens, j), WIDTH, PREC, false);
+      writer_char (out, ' ');
+      writer_fixed (out, sqrt (ens_var (ens, j)), WIDTH, PREC, false);
+      for (int q = 1; q < 4; q++)
+	{
+	  writer_char (out, ' ');
+	  writer_fixed (out, ens_quantile (ens, j, q / 4.0), WIDTH, PREC, false);
+	}
+      writer_char (out, '\n');
+    }
+  ens_free (ens);
+#endif  /* ENSEMBLE */
+  ws_free (ws);
+  if (writer_free (out) != 0)
+    error (EXIT_FAILURE, errno, "Failed write");
   return 0;
 }
 
@@ -188,3 +185,15 @@ selection (double * freqs, double * W)
     /* update freqs with new frequencies */
     freqs[i] = freqs[i] * W[i] / wbar;
 }
+
+void
+tlta_print (haploid_writer_t * out, double * allele)
+{
+  /* one line of allele frequencies */
+  for (int j = 0; j < NLOCI; j++)
+    {
+      writer_fixed (out, allele[j], WIDTH, PREC, false);
+      writer_char (out, ' ');
+    }
+  writer_char (out, '\n');
+}
@@ -0,0 +1,209 @@
+/*
+
+  active.c: recombination over the genotypes that are still present
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Under selection most genotypes soon have negligible frequencies, but
+   rec_mating () still reads every entry of the table.  Here the table
+   is rearranged parent-major: the entries for parents (K, J) are
+   contiguous, as (offspring, value) pairs, so that a generation visits
+   only the pairs of active parents.  A pair with an inactive parent
+   is skipped, whether the other parent is active or not; each parent
+   pair's offspring probabilities sum to one, so the offspring mass
+   lost is the mating table's mass over those pairs.  Summing that
+   would read the whole table, so it is taken from the parents'
+   frequencies instead: under random mating it is the square of their
+   total less the square of the active genotypes' total.
+
+   The active set is carried from one generation to the next: the
+   parents of the next generation are this generation's offspring, so
+   only the offspring of active pairs can be active next time, and
+   those at or above the threshold are.  Selection between generations
+   rescales frequencies but cannot revive a genotype that is gone. */
+
+#include <stdint.h>
+#include <string.h>
+#include "haploid.h"
+#include "sparse.h"
+#include "stats.h"
+
+struct rec_active_t
+{
+  size_t geno;
+  double threshold;
+  size_t * start;		/* GENO^2 + 1 offsets, by K * GENO + J */
+  uint32_t * target;		/* the offspring of each entry */
+  double * val;
+  size_t nactive;
+  uint32_t * active;		/* the active genotypes */
+  size_t ntouched;
+  uint32_t * touched;		/* offspring reached this generation */
+  _Bool * seen;			/* GENO flags for TOUCHED */
+};
+
+rec_active_t *
+rec_active_new (rtable_t ** rtable, size_t geno, double threshold)
+{
+  /* rearrange RTABLE parent-major, with every genotype active */
+  if ((geno < 2) || (geno > UINT32_MAX) || !(threshold >= 0.0))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  rec_active_t * a = malloc (sizeof (rec_active_t));
+  if (a == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  a->geno = geno;
+  a->threshold = threshold;
+  a->start = calloc (geno * geno + 1, sizeof (size_t));
+  a->active = malloc (geno * sizeof (uint32_t));
+  a->touched = malloc (geno * sizeof (uint32_t));
+  a->seen = calloc (geno, sizeof (_Bool));
+  if ((a->start == NULL) || (a->active == NULL) || (a->touched == NULL)
+      || (a->seen == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+
+  /* count the entries of each pair, then place them */
+  size_t nnz = 0;
+  for (size_t t = 0; t < geno; t++)
+    for (rtable_t * elt = rtable[t]; elt != NULL; elt = elt->next)
+      if (elt->val != 0.0)
+	{
+	  a->start[elt->indices[0] * geno + elt->indices[1] + 1]++;
+	  nnz++;
+	}
+  for (size_t p = 0; p < geno * geno; p++)
+    a->start[p + 1] += a->start[p];
+  a->target = malloc (nnz * sizeof (uint32_t));
+  a->val = malloc (nnz * sizeof (double));
+  size_t * fill = malloc (geno * geno * sizeof (size_t));
+  if ((a->target == NULL) || (a->val == NULL) || (fill == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  memcpy (fill, a->start, geno * geno * sizeof (size_t));
+  for (size_t t = 0; t < geno; t++)
+    for (rtable_t * elt = rtable[t]; elt != NULL; elt = elt->next)
+      if (elt->val != 0.0)
+	{
+	  size_t e = fill[elt->indices[0] * geno + elt->indices[1]]++;
+	  a->target[e] = t;
+	  a->val[e] = elt->val;
+	}
+  free (fill);
+
+  a->nactive = geno;
+  for (size_t i = 0; i < geno; i++)
+    a->active[i] = i;
+  a->ntouched = 0;
+  return a;
+}
+
+void
+rec_active_free (rec_active_t * a)
+{
+  if (a == NULL)
+    return;
+  free (a->start);
+  free (a->target);
+  free (a->val);
+  free (a->active);
+  free (a->touched);
+  free (a->seen);
+  free (a);
+}
+
+void
+rec_active_reset (rec_active_t * a, const double * freqs)
+{
+  /* make active exactly the genotypes whose frequency in FREQS is at
+     least the threshold, or all of them if FREQS is NULL */
+  a->nactive = 0;
+  for (size_t i = 0; i < a->geno; i++)
+    if ((freqs == NULL) || isgreaterequal (freqs[i], a->threshold))
+      a->active[a->nactive++] = i;
+}
+
+size_t
+rec_active_count (const rec_active_t * a)
+{
+  return a->nactive;
+}
+
+double
+rec_active_mating (double * freqs, double ** mtable, rec_active_t * a)
+{
+  /* replace the parents' frequencies in FREQS by the offspring of
+     MTABLE from the active pairs; returns the mass of the pairs with
+     an inactive parent under random mating, the offspring mass
+     ignored */
+  size_t geno = a->geno;
+  STATS_BEGIN (STATS_STAGE_RECOMB);
+  STATS_ADD (STATS_GENERATIONS, 1);
+  double total = 0.0, kept = 0.0;
+  for (size_t i = 0; i < geno; i++)
+    total += freqs[i];
+  for (size_t x = 0; x < a->nactive; x++)
+    kept += freqs[a->active[x]];
+  double ignored = (total - kept) * (total + kept);
+  memset (freqs, 0, geno * sizeof (double));
+
+  for (size_t x = 0; x < a->nactive; x++)
+    {
+      uint32_t k = a->active[x];
+      const size_t * row = a->start + (size_t) k * geno;
+      for (size_t y = 0; y < a->nactive; y++)
+	{
+	  uint32_t j = a->active[y];
+	  double m = mtable[k][j];
+	  if (m == 0.0)
+	    continue;
+	  for (size_t e = row[j]; e < row[j + 1]; e++)
+	    {
+	      uint32_t t = a->target[e];
+	      freqs[t] += m * a->val[e];
+	      if (!a->seen[t])
+		{
+		  a->seen[t] = true;
+		  a->touched[a->ntouched++] = t;
+		}
+	    }
+	}
+    }
+
+  /* the next generation's parents */
+  a->nactive = 0;
+  for (size_t x = 0; x < a->ntouched; x++)
+    {
+      uint32_t t = a->touched[x];
+      a->seen[t] = false;
+      if (isgreaterequal (freqs[t], a->threshold))
+	a->active[a->nactive++] = t;
+    }
+  a->ntouched = 0;
+  STATS_END (STATS_STAGE_RECOMB);
+  return isgreater (ignored, 0.0) ? ignored : 0.0;
+}
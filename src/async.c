@@ -0,0 +1,235 @@
+/*
+
+  async.c: writing records from a thread of their own
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* The simulation thread (the producer) copies fixed-size records into
+   a ring of slots and returns at once; a writer thread (the consumer)
+   takes them out in order and hands each to an encoding function,
+   which formats and writes it.  With one producer and one consumer the
+   ring needs no lock: the producer alone advances TAIL and the
+   consumer alone advances HEAD, each publishing with a release store
+   what the other reads with an acquire load.  The two counters run
+   freely and are reduced modulo the number of slots, a power of two.
+
+   When the ring is full the producer either waits for a slot
+   (ASYNC_BLOCK, back-pressure) or discards the record and counts it
+   (ASYNC_DROP).  An idle writer thread sleeps briefly between polls
+   rather than waiting on a condition, so the producer never takes a
+   lock or makes a system call to hand over a record. */
+
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "haploid.h"
+
+/* how long the writer thread sleeps when the ring is empty */
+#define ASYNC_IDLE_NS 50000
+
+struct haploid_async_t
+{
+  size_t recsize;		/* bytes per record */
+  size_t mask;			/* number of slots - 1 */
+  unsigned char * slots;
+  int policy;
+  async_encode_t encode;
+  void * arg;
+  pthread_t thread;
+  /* the producer's counter, on a cache line of its own */
+  atomic_size_t tail __attribute__ ((aligned (64)));
+  char tail_pad[64 - sizeof (atomic_size_t)];
+  /* the consumer's */
+  atomic_size_t head __attribute__ ((aligned (64)));
+  char head_pad[64 - sizeof (atomic_size_t)];
+  atomic_bool done;		/* no more records */
+  atomic_uint_fast64_t dropped;
+  int status;			/* the first failure of ENCODE */
+};
+
+static void *
+async_run (void * p)
+{
+  /* the writer thread */
+  haploid_async_t * a = p;
+  struct timespec idle = { 0, ASYNC_IDLE_NS };
+  size_t head = atomic_load_explicit (&a->head, memory_order_relaxed);
+  for (;;)
+    {
+      size_t tail = atomic_load_explicit (&a->tail, memory_order_acquire);
+      if (head == tail)
+	{
+	  /* check DONE only after seeing the ring empty, so records
+	     pushed before async_free () are all written */
+	  if (atomic_load_explicit (&a->done, memory_order_acquire)
+	      && (head == atomic_load_explicit (&a->tail,
+						memory_order_acquire)))
+	    break;
+	  nanosleep (&idle, NULL);
+	  continue;
+	}
+      for (; head != tail; head++)
+	{
+	  int status = a->encode (a->slots + (head & a->mask) * a->recsize,
+				  a->arg);
+	  if ((status != 0) && (a->status == 0))
+	    a->status = status;
+	  /* give the slot back */
+	  atomic_store_explicit (&a->head, head + 1, memory_order_release);
+	}
+    }
+  return NULL;
+}
+
+haploid_async_t *
+async_new (size_t recsize, size_t nslots, int policy,
+	   async_encode_t encode, void * arg)
+{
+  /* a ring of at least NSLOTS records of RECSIZE bytes, passed to
+     ENCODE (with ARG) by a new writer thread */
+  if ((recsize == 0) || (nslots == 0) || (encode == NULL)
+      || ((policy != ASYNC_BLOCK) && (policy != ASYNC_DROP)))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  size_t cap = 1;
+  while (cap < nslots)
+    cap <<= 1;
+  /* keep the counters on their own cache lines */
+  void * p = NULL;
+  if (posix_memalign (&p, 64, sizeof (haploid_async_t)) != 0)
+    error (0, ENOMEM, "Null pointer\n");
+  haploid_async_t * a = p;
+  a->slots = malloc (cap * recsize);
+  if (a->slots == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  a->recsize = recsize;
+  a->mask = cap - 1;
+  a->policy = policy;
+  a->encode = encode;
+  a->arg = arg;
+  a->status = 0;
+  atomic_init (&a->tail, 0);
+  atomic_init (&a->head, 0);
+  atomic_init (&a->done, false);
+  atomic_init (&a->dropped, 0);
+  int err = pthread_create (&a->thread, NULL, async_run, a);
+  if (err != 0)
+    {
+      free (a->slots);
+      free (a);
+      errno = err;
+      return NULL;
+    }
+  return a;
+}
+
+void *
+async_reserve (haploid_async_t * a)
+{
+  /* the next free slot, to be filled in and handed over with
+     async_commit (); NULL if the ring is full and the policy is
+     ASYNC_DROP (the record is counted as dropped) */
+  size_t tail = atomic_load_explicit (&a->tail, memory_order_relaxed);
+  while (tail - atomic_load_explicit (&a->head, memory_order_acquire)
+	 > a->mask)
+    {
+      if (a->policy == ASYNC_DROP)
+	{
+	  atomic_fetch_add_explicit (&a->dropped, 1, memory_order_relaxed);
+	  return NULL;
+	}
+      sched_yield ();
+    }
+  return a->slots + (tail & a->mask) * a->recsize;
+}
+
+void
+async_commit (haploid_async_t * a)
+{
+  /* hand over the slot from async_reserve () */
+  size_t tail = atomic_load_explicit (&a->tail, memory_order_relaxed);
+  atomic_store_explicit (&a->tail, tail + 1, memory_order_release);
+}
+
+int
+async_push (haploid_async_t * a, const void * rec)
+{
+  /* copy REC into the ring; return 0, or -1 with errno EAGAIN if it
+     was dropped */
+  void * slot = async_reserve (a);
+  if (slot == NULL)
+    {
+      errno = EAGAIN;
+      return -1;
+    }
+  memcpy (slot, rec, a->recsize);
+  async_commit (a);
+  return 0;
+}
+
+uint64_t
+async_dropped (haploid_async_t * a)
+{
+  return atomic_load_explicit (&a->dropped, memory_order_relaxed);
+}
+
+int
+async_free (haploid_async_t * a)
+{
+  /* write out everything pushed, stop the writer thread and free A;
+     return the first nonzero status from the encoding function */
+  if (a == NULL)
+    return 0;
+  atomic_store_explicit (&a->done, true, memory_order_release);
+  pthread_join (a->thread, NULL);
+  int status = a->status;
+  free (a->slots);
+  free (a);
+  return status;
+}
+
+int
+async_write_raw (const void * rec, void * arg)
+{
+  /* an encoding function: copy the record unchanged to a writer; ARG
+     is an async_raw_t */
+  async_raw_t * raw = arg;
+  return writer_bytes (raw->w, rec, raw->recsize);
+}
+
+int
+async_write_traj (const void * rec, void * arg)
+{
+  /* an encoding function: offer a record holding a uint64_t generation
+     and then the frequencies to the trajectory in ARG */
+  const uint64_t * gen = rec;
+  return (traj_record (arg, *gen, (const double *) (gen + 1)) < 0) ? -1 : 0;
+}
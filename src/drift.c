@@ -0,0 +1,112 @@
+/*
+
+  drift.c: genetic drift in finite populations
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Wright-Fisher drift resamples the genotype frequencies as a
+   multinomial draw of N individuals.  The multinomial is built from
+   sequential conditional binomials from rng_binomial (), so the cost
+   of a draw does not grow with N.  Random numbers come from a stream
+   supplied by the caller (see rng.c). */
+
+#include "haploid.h"
+
+void
+drift_multinomial (unsigned long n, double * p, size_t len,
+		   unsigned long * counts, haploid_rng_t * rng)
+{
+  /* distribute N draws over LEN categories with probabilities
+     proportional to P, as a sequence of binomials each conditional on
+     the draws left over */
+  double rest = 0.0;
+  for (size_t i = 0; i < len; i++)
+    rest += p[i];
+  for (size_t i = 0; i < len; i++)
+    {
+      if ((n == 0) || !isgreater (rest, 0.0))
+	{
+	  counts[i] = 0;
+	  continue;
+	}
+      if (i == len - 1)
+	counts[i] = n;
+      else
+	counts[i] = rng_binomial (rng, n, p[i] / rest);
+      n -= counts[i];
+      rest -= p[i];
+    }
+}
+
+int
+drift_wf (double * freqs, size_t geno, unsigned long N,
+	  haploid_rng_t * rng)
+{
+  /* Wright-Fisher drift: replace FREQS by the frequencies in a sample
+     of N individuals; this is drift_multinomial () done in place,
+     each frequency being read just before it is replaced */
+  if (N == 0)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  unsigned long n = N;
+  double rest = 0.0;
+  for (size_t i = 0; i < geno; i++)
+    rest += freqs[i];
+  for (size_t i = 0; i < geno; i++)
+    {
+      double p = freqs[i];
+      unsigned long count;
+      if ((n == 0) || !isgreater (rest, 0.0))
+	count = 0;
+      else if (i == geno - 1)
+	count = n;
+      else
+	count = rng_binomial (rng, n, p / rest);
+      freqs[i] = (double) count / N;
+      n -= count;
+      rest -= p;
+    }
+  return 0;
+}
+
+int
+drift_wf_batch (double * freqs, size_t geno, size_t nrep,
+		unsigned long N, haploid_rng_t * rng)
+{
+  /* drift_wf () for NREP replicate populations stored one after the
+     other in FREQS (NREP * GENO entries) */
+  if (N == 0)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  for (size_t rep = 0; rep < nrep; rep++)
+    drift_wf (freqs + rep * geno, geno, N, rng);
+  return 0;
+}
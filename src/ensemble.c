@@ -0,0 +1,269 @@
+/*
+
+  ensemble.c: online statistics across replicate trials
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* An ensemble reducer summarizes NSTAT numbers from each replicate (a
+   replicate's final frequencies, its LD, its time to fixation, ...)
+   without keeping the replicates.  For each statistic it keeps the
+   count, mean and sum of squared deviations, updated by Welford's
+   method; the extremes; and counts in NBINS equal bins over a range
+   given in advance, from which quantiles are interpolated.  A
+   statistic that is NAN in some replicate (a time to fixation when
+   nothing fixed) is left out for that replicate.
+
+   Reducers with the same shape merge (Chan, Golub and LeVeque 1979),
+   so threads or processes can each reduce their own replicates.  The
+   counts merge exactly; the moments are floating point, so merging the
+   same partial results in the same order always gives the same bits.
+   A reducer serializes to a flat little record for passing between
+   processes. */
+
+#include <string.h>
+#include "haploid.h"
+
+#define ENS_MAGIC "HAPENS01"
+
+ens_t *
+ens_new (size_t nstat, size_t nbins, const double * lo, const double * hi)
+{
+  /* a reducer for NSTAT statistics, each with NBINS bins over
+     [LO[i], HI[i]] ([0, 1] if LO and HI are NULL) */
+  if ((nstat == 0) || (nbins == 0) || ((lo == NULL) != (hi == NULL)))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  ens_t * e = malloc (sizeof (ens_t));
+  if (e == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  e->nstat = nstat;
+  e->nbins = nbins;
+  e->stats = malloc (nstat * sizeof (ens_stat_t));
+  e->bins = calloc (nstat * nbins, sizeof (uint64_t));
+  if ((e->stats == NULL) || (e->bins == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  for (size_t i = 0; i < nstat; i++)
+    {
+      ens_stat_t * s = e->stats + i;
+      s->lo = (lo == NULL) ? 0.0 : lo[i];
+      s->hi = (hi == NULL) ? 1.0 : hi[i];
+      if (!(s->lo < s->hi))
+	{
+	  ens_free (e);
+	  errno = EINVAL;
+	  return NULL;
+	}
+      s->n = 0;
+      s->mean = 0.0;
+      s->m2 = 0.0;
+      s->min = INFINITY;
+      s->max = -INFINITY;
+      s->under = 0;
+      s->over = 0;
+    }
+  return e;
+}
+
+void
+ens_free (ens_t * e)
+{
+  if (e == NULL)
+    return;
+  free (e->stats);
+  free (e->bins);
+  free (e);
+}
+
+void
+ens_add (ens_t * e, const double * x)
+{
+  /* the NSTAT statistics of one replicate */
+  size_t nbins = e->nbins;
+  for (size_t i = 0; i < e->nstat; i++)
+    {
+      if (isnan (x[i]))
+	continue;
+      ens_stat_t * s = e->stats + i;
+      s->n++;
+      double d = x[i] - s->mean;
+      s->mean += d / s->n;
+      s->m2 += d * (x[i] - s->mean);
+      s->min = fmin (s->min, x[i]);
+      s->max = fmax (s->max, x[i]);
+      if (x[i] < s->lo)
+	s->under++;
+      else if (x[i] > s->hi)
+	s->over++;
+      else
+	{
+	  size_t b = (x[i] - s->lo) / (s->hi - s->lo) * nbins;
+	  /* the top edge belongs to the last bin */
+	  e->bins[i * nbins + ((b < nbins) ? b : nbins - 1)]++;
+	}
+    }
+}
+
+int
+ens_merge (ens_t * into, const ens_t * from)
+{
+  /* add the replicates summarized in FROM to INTO */
+  if ((into->nstat != from->nstat) || (into->nbins != from->nbins))
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  for (size_t i = 0; i < into->nstat; i++)
+    if ((into->stats[i].lo != from->stats[i].lo)
+	|| (into->stats[i].hi != from->stats[i].hi))
+      {
+	errno = EINVAL;
+	return -1;
+      }
+  for (size_t i = 0; i < into->nstat; i++)
+    {
+      ens_stat_t * a = into->stats + i;
+      const ens_stat_t * b = from->stats + i;
+      if (b->n == 0)
+	continue;
+      uint64_t n = a->n + b->n;
+      double d = b->mean - a->mean;
+      a->mean += d * ((double) b->n / n);
+      a->m2 += b->m2 + d * d * ((double) a->n * b->n / n);
+      a->n = n;
+      a->min = fmin (a->min, b->min);
+      a->max = fmax (a->max, b->max);
+      a->under += b->under;
+      a->over += b->over;
+    }
+  for (size_t k = 0; k < into->nstat * into->nbins; k++)
+    into->bins[k] += from->bins[k];
+  return 0;
+}
+
+uint64_t
+ens_count (const ens_t * e, size_t i)
+{
+  return e->stats[i].n;
+}
+
+double
+ens_mean (const ens_t * e, size_t i)
+{
+  return (e->stats[i].n > 0) ? e->stats[i].mean : NAN;
+}
+
+double
+ens_var (const ens_t * e, size_t i)
+{
+  /* the sample variance */
+  return (e->stats[i].n > 1) ? e->stats[i].m2 / (e->stats[i].n - 1) : NAN;
+}
+
+double
+ens_quantile (const ens_t * e, size_t i, double q)
+{
+  /* the Q quantile of statistic I, interpolated within its bin; values
+     outside the binned range are known only by the extremes */
+  const ens_stat_t * s = e->stats + i;
+  if ((s->n == 0) || !(q >= 0.0) || (q > 1.0))
+    return NAN;
+  double target = q * s->n;
+  double below = s->under;
+  /* nothing observed is below the minimum, whether or not it is
+     below the bins */
+  if (target <= below)
+    return s->min;
+  const uint64_t * bins = e->bins + i * e->nbins;
+  double width = (s->hi - s->lo) / e->nbins;
+  for (size_t b = 0; b < e->nbins; b++)
+    {
+      if ((bins[b] > 0) && (target <= below + bins[b]))
+	{
+	  double x = s->lo + width * (b + (target - below) / bins[b]);
+	  return fmin (fmax (x, s->min), s->max);
+	}
+      below += bins[b];
+    }
+  return s->max;
+}
+
+size_t
+ens_size (const ens_t * e)
+{
+  /* bytes written by ens_write () */
+  return sizeof (ENS_MAGIC) - 1 + 2 * sizeof (uint64_t)
+    + e->nstat * (sizeof (ens_stat_t) + e->nbins * sizeof (uint64_t));
+}
+
+int
+ens_write (haploid_writer_t * w, const ens_t * e)
+{
+  /* serialize E (in the byte order of this machine) */
+  uint64_t shape[2] = { e->nstat, e->nbins };
+  writer_bytes (w, ENS_MAGIC, sizeof (ENS_MAGIC) - 1);
+  writer_bytes (w, shape, sizeof (shape));
+  writer_bytes (w, e->stats, e->nstat * sizeof (ens_stat_t));
+  return writer_bytes (w, e->bins, e->nstat * e->nbins * sizeof (uint64_t));
+}
+
+ens_t *
+ens_read (const void * buf, size_t len)
+{
+  /* a reducer from the LEN bytes that ens_write () left at BUF, or
+     NULL with errno EINVAL if they are not one */
+  const char * p = buf;
+  uint64_t shape[2];
+  if ((len < sizeof (ENS_MAGIC) - 1 + sizeof (shape))
+      || (memcmp (p, ENS_MAGIC, sizeof (ENS_MAGIC) - 1) != 0))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  p += sizeof (ENS_MAGIC) - 1;
+  memcpy (shape, p, sizeof (shape));
+  p += sizeof (shape);
+  if ((shape[0] == 0) || (shape[1] == 0)
+      || (shape[0] > len / sizeof (ens_stat_t))
+      || (shape[1] > len / sizeof (uint64_t) / shape[0]))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  ens_t * e = ens_new (shape[0], shape[1], NULL, NULL);
+  if (ens_size (e) != len)
+    {
+      ens_free (e);
+      errno = EINVAL;
+      return NULL;
+    }
+  memcpy (e->stats, p, e->nstat * sizeof (ens_stat_t));
+  p += e->nstat * sizeof (ens_stat_t);
+  memcpy (e->bins, p, e->nstat * e->nbins * sizeof (uint64_t));
+  return e;
+}
@@ -0,0 +1,298 @@
+/*
+
+  exec.c: running independent trials on threads that share the work
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Trials take very different numbers of generations to converge, so
+   handing each thread an equal share of them leaves threads idle while
+   the slowest finishes.  Here each worker has a deque of trials: it
+   runs the trial at the bottom of its own, and when that is empty it
+   steals from the top of another's, so no worker is idle while any
+   trial is waiting.  A task may finish its trial or yield after a
+   chunk of generations; a yielded trial goes back on the bottom of its
+   worker's deque, where it runs next unless another worker steals
+   it.
+
+   Nothing a trial computes depends on the thread it runs on: each
+   trial has its own random number stream, named by the seed and the
+   trial, and writes its result to its own slot, so the results are in
+   trial order and are the same with any number of threads.  Each
+   worker has a workspace (see ws.c) for the scratch space of whatever
+   trial it is running.  The deques are short and touched once a chunk,
+   so each has a lock rather than the lock-free protocol. */
+
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "haploid.h"
+
+typedef struct exec_worker_t exec_worker_t;
+struct exec_worker_t
+{
+  pthread_mutex_t lock;
+  size_t * ring;		/* the deque, of the run's capacity */
+  size_t top;			/* stolen from */
+  size_t bottom;		/* pushed and popped by the owner */
+  size_t id;
+  haploid_ws_t * ws;
+  haploid_exec_t * exec;
+  uint64_t steals;
+  uint64_t yields;
+};
+
+struct haploid_exec_t
+{
+  size_t nthreads;
+  exec_worker_t * workers;
+  size_t cap;			/* of each deque */
+  /* the current run */
+  exec_task_t task;
+  void * arg;
+  haploid_rng_t * rngs;		/* one for each trial */
+  unsigned char * results;
+  size_t resultsize;
+  atomic_size_t left;		/* trials not finished */
+  atomic_size_t failed;
+};
+
+haploid_exec_t *
+exec_new (size_t nthreads, size_t nloci)
+{
+  /* a pool of NTHREADS workers (one for each processor if 0), each
+     with a workspace for NLOCI loci (none if NLOCI is 0) */
+  if (nthreads == 0)
+    {
+      long n = sysconf (_SC_NPROCESSORS_ONLN);
+      nthreads = (n > 0) ? n : 1;
+    }
+  haploid_exec_t * exec = malloc (sizeof (haploid_exec_t));
+  if (exec == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  exec->workers = calloc (nthreads, sizeof (exec_worker_t));
+  if (exec->workers == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  exec->nthreads = nthreads;
+  exec->cap = 0;
+  for (size_t k = 0; k < nthreads; k++)
+    {
+      exec_worker_t * w = exec->workers + k;
+      pthread_mutex_init (&w->lock, NULL);
+      w->id = k;
+      w->exec = exec;
+      w->ws = NULL;
+      if ((nloci > 0) && ((w->ws = ws_new (nloci)) == NULL))
+	{
+	  exec_free (exec);
+	  errno = EINVAL;
+	  return NULL;
+	}
+    }
+  return exec;
+}
+
+void
+exec_free (haploid_exec_t * exec)
+{
+  if (exec == NULL)
+    return;
+  for (size_t k = 0; k < exec->nthreads; k++)
+    {
+      pthread_mutex_destroy (&exec->workers[k].lock);
+      free (exec->workers[k].ring);
+      ws_free (exec->workers[k].ws);
+    }
+  free (exec->workers);
+  free (exec);
+}
+
+size_t
+exec_nthreads (const haploid_exec_t * exec)
+{
+  return exec->nthreads;
+}
+
+static void
+exec_push (exec_worker_t * w, size_t trial)
+{
+  pthread_mutex_lock (&w->lock);
+  w->ring[w->bottom++ % w->exec->cap] = trial;
+  pthread_mutex_unlock (&w->lock);
+}
+
+static _Bool
+exec_pop (exec_worker_t * w, size_t * trial)
+{
+  /* the trial at the bottom of W's own deque */
+  _Bool found = false;
+  pthread_mutex_lock (&w->lock);
+  if (w->bottom > w->top)
+    {
+      *trial = w->ring[--w->bottom % w->exec->cap];
+      found = true;
+    }
+  pthread_mutex_unlock (&w->lock);
+  return found;
+}
+
+static _Bool
+exec_steal (exec_worker_t * w, size_t * trial)
+{
+  /* the trial at the top of another worker's deque, trying each in
+     turn from the next */
+  haploid_exec_t * exec = w->exec;
+  for (size_t i = 1; i < exec->nthreads; i++)
+    {
+      exec_worker_t * v = exec->workers + (w->id + i) % exec->nthreads;
+      _Bool found = false;
+      pthread_mutex_lock (&v->lock);
+      if (v->bottom > v->top)
+	{
+	  *trial = v->ring[v->top++ % exec->cap];
+	  found = true;
+	}
+      pthread_mutex_unlock (&v->lock);
+      if (found)
+	{
+	  w->steals++;
+	  return true;
+	}
+    }
+  return false;
+}
+
+static void *
+exec_worker (void * arg)
+{
+  exec_worker_t * w = arg;
+  haploid_exec_t * exec = w->exec;
+  exec_ctx_t ctx = { 0, w->id, NULL, w->ws, NULL };
+  while (atomic_load_explicit (&exec->left, memory_order_acquire) > 0)
+    {
+      size_t trial;
+      if (!exec_pop (w, &trial) && !exec_steal (w, &trial))
+	{
+	  /* every waiting trial is running somewhere */
+	  sched_yield ();
+	  continue;
+	}
+      ctx.trial = trial;
+      ctx.rng = exec->rngs + trial;
+      ctx.result = exec->results + trial * exec->resultsize;
+      int status = exec->task (&ctx, exec->arg);
+      if (status == EXEC_YIELD)
+	{
+	  w->yields++;
+	  exec_push (w, trial);
+	  continue;
+	}
+      if (status != EXEC_DONE)
+	atomic_fetch_add_explicit (&exec->failed, 1, memory_order_relaxed);
+      atomic_fetch_sub_explicit (&exec->left, 1, memory_order_release);
+    }
+  return NULL;
+}
+
+size_t
+exec_run (haploid_exec_t * exec, size_t ntrials, exec_task_t task,
+	  void * arg, uint64_t seed, void * results, size_t resultsize)
+{
+  /* run NTRIALS trials of TASK, with ARG, until each returns EXEC_DONE
+     or fails; trial T has the random number stream (SEED, 0, T, 0) and
+     the slot of RESULTSIZE bytes at T * RESULTSIZE in RESULTS (which
+     may be NULL if RESULTSIZE is 0).  Returns the number that failed,
+     returning neither EXEC_DONE nor EXEC_YIELD */
+  if (ntrials == 0)
+    return 0;
+  if (ntrials > exec->cap)
+    {
+      for (size_t k = 0; k < exec->nthreads; k++)
+	{
+	  free (exec->workers[k].ring);
+	  exec->workers[k].ring = malloc (ntrials * sizeof (size_t));
+	  if (exec->workers[k].ring == NULL)
+	    error (0, ENOMEM, "Null pointer\n");
+	}
+      exec->cap = ntrials;
+    }
+  exec->rngs = malloc (ntrials * sizeof (haploid_rng_t));
+  if (exec->rngs == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  for (size_t t = 0; t < ntrials; t++)
+    rng_init (exec->rngs + t, seed, 0, t, 0);
+  exec->task = task;
+  exec->arg = arg;
+  exec->results = results;
+  exec->resultsize = resultsize;
+  atomic_init (&exec->left, ntrials);
+  atomic_init (&exec->failed, 0);
+
+  /* deal the trials out, each worker's first at its bottom */
+  for (size_t k = 0; k < exec->nthreads; k++)
+    {
+      exec_worker_t * w = exec->workers + k;
+      w->top = w->bottom = 0;
+      w->steals = w->yields = 0;
+    }
+  for (size_t t = ntrials; t-- > 0;)
+    exec_push (exec->workers + t % exec->nthreads, t);
+
+  /* this thread is the first worker */
+  pthread_t * threads = malloc (exec->nthreads * sizeof (pthread_t));
+  if (threads == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  for (size_t k = 1; k < exec->nthreads; k++)
+    {
+      /* pthread_create () returns its error rather than setting errno */
+      int err = pthread_create (threads + k, NULL, exec_worker,
+				exec->workers + k);
+      if (err != 0)
+	error (EXIT_FAILURE, err, "Failed to start a worker");
+    }
+  exec_worker (exec->workers);
+  for (size_t k = 1; k < exec->nthreads; k++)
+    pthread_join (threads[k], NULL);
+  free (threads);
+  free (exec->rngs);
+  exec->rngs = NULL;
+  return atomic_load_explicit (&exec->failed, memory_order_relaxed);
+}
+
+void
+exec_counts (const haploid_exec_t * exec, uint64_t * steals,
+	     uint64_t * yields)
+{
+  /* trials stolen and chunks yielded in the last run */
+  *steals = *yields = 0;
+  for (size_t k = 0; k < exec->nthreads; k++)
+    {
+      *steals += exec->workers[k].steals;
+      *yields += exec->workers[k].yields;
+    }
+}
@@ -0,0 +1,251 @@
+/*
+
+  fixed.c: recombination kernels specialized for small genomes
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Most models have only a handful of loci.  For those, the offspring
+   frequencies are found from the recombination map itself instead of
+   from the table's entries.  An offspring copies its first locus from
+   either parent, and each later locus from the parent it copied the
+   one before, unless the interval between them recombines, which
+   switches parents.  Walking along the loci this way, the mating table
+   is summed down one locus at a time: after T loci every entry is a
+   sum over the T loci already copied, indexed by those loci of the
+   offspring and by the remaining loci of the parent being copied and
+   of the other one.  Each step halves the work of the one before, so
+   the walk takes a small multiple of GENO^2 operations, against
+   GENO 3^N multiplications for the entries of a table of N loci.
+
+   The kernel for each number of loci is generated by REC_FIXED_KERNEL,
+   so that every array size and loop bound is a constant.  The mating
+   table is read in place, in square blocks of its first LOW loci,
+   while the parents of the walk are told apart; only the sums over
+   those loci are kept, which bounds the scratch at 52 KiB for eight
+   loci. */
+
+#include <stdint.h>
+#include <string.h>
+#include "haploid.h"
+#include "sparse.h"
+
+static inline void
+rec_fixed_first (double * restrict w, double ** mtable, size_t row,
+		 size_t col, size_t low)
+{
+  /* copy the first locus from the block of MTABLE with corner (ROW,
+     COL) and LOW loci per side: W[s][o][x][y] sums the entries whose
+     offspring took locus O from parent S (the row or the column), and
+     whose parents have the further loci X and Y */
+  size_t half = (size_t) 1 << (low - 1);
+  double * w0 = w;
+  double * w1 = w + 2 * half * half;
+  for (size_t o = 0; o < 2; o++)
+    for (size_t x = 0; x < half; x++)
+      {
+	const double * mo = mtable[row + 2 * x + o] + col;
+	const double * m0 = mtable[row + 2 * x] + col;
+	const double * m1 = mtable[row + 2 * x + 1] + col;
+	for (size_t y = 0; y < half; y++)
+	  {
+	    w0[(o * half + x) * half + y] = mo[2 * y] + mo[2 * y + 1];
+	    w1[(o * half + x) * half + y] = m0[2 * y + o] + m1[2 * y + o];
+	  }
+      }
+}
+
+static inline void
+rec_fixed_low (double * restrict next, const double * restrict w,
+	       size_t t, size_t low, double r)
+{
+  /* copy locus T of a block of LOW loci per side from W to NEXT,
+     switching parents with probability R */
+  size_t nout = (size_t) 1 << t;
+  size_t len = (size_t) 1 << (low - t);
+  size_t half = len / 2;
+  const double * w0 = w;
+  const double * w1 = w + nout * len * len;
+  double * n0 = next;
+  double * n1 = next + 2 * nout * half * half;
+  for (size_t z = 0; z < 2; z++)
+    for (size_t o = 0; o < nout; o++)
+      for (size_t x = 0; x < half; x++)
+	for (size_t y = 0; y < half; y++)
+	  {
+	    size_t at = ((z * nout + o) * half + x) * half + y;
+	    /* locus T is Z in the row parent */
+	    size_t i = (o * len + 2 * x + z) * len + 2 * y;
+	    double from0 = w0[i] + w0[i + 1];
+	    double from1 = w1[i] + w1[i + 1];
+	    n0[at] = (1.0 - r) * from0 + r * from1;
+	    /* or in the column parent */
+	    size_t j = (o * len + 2 * x) * len + 2 * y + z;
+	    from0 = w0[j] + w0[j + len];
+	    from1 = w1[j] + w1[j + len];
+	    n1[at] = r * from0 + (1.0 - r) * from1;
+	  }
+}
+
+static inline void
+rec_fixed_high (double * restrict next, const double * restrict u,
+		size_t t, size_t nloci, double r)
+{
+  /* copy locus T of NLOCI from U to NEXT, switching parents with
+     probability R; U[o][a][b] has the loci O of the offspring, A of
+     the parent being copied and B of the other one */
+  size_t nout = (size_t) 1 << t;
+  size_t len = (size_t) 1 << (nloci - t);
+  size_t half = len / 2;
+  for (size_t z = 0; z < 2; z++)
+    for (size_t o = 0; o < nout; o++)
+      for (size_t a = 0; a < half; a++)
+	for (size_t b = 0; b < half; b++)
+	  {
+	    /* keep copying the parent with Z at locus T */
+	    size_t i = (o * len + 2 * a + z) * len + 2 * b;
+	    /* or switch to it from the other one */
+	    size_t j = (o * len + 2 * b) * len + 2 * a + z;
+	    next[((z * nout + o) * half + a) * half + b]
+	      = (1.0 - r) * (u[i] + u[i + 1]) + r * (u[j] + u[j + len]);
+	  }
+}
+
+#define REC_FIXED_KERNEL(N)						\
+  static void								\
+  rec_mating_##N (double * freqs, double ** mtable, const double * r)	\
+  {									\
+    enum { LOW = (N + 1) / 2, SIDE = 1 << LOW, NHIGH = 1 << (N - LOW),	\
+	   USIZE = SIDE * NHIGH * NHIGH };				\
+    double w[2][SIDE * SIDE];						\
+    double u[USIZE];							\
+    double v[(USIZE + 1) / 2];						\
+    memset (u, 0, sizeof (u));						\
+    for (int a = 0; a < NHIGH; a++)					\
+      for (int b = 0; b < NHIGH; b++)					\
+	{								\
+	  rec_fixed_first (w[0], mtable, a * SIDE, b * SIDE, LOW);	\
+	  int cur = 0;							\
+	  for (int t = 1; t < LOW; t++, cur ^= 1)			\
+	    rec_fixed_low (w[cur ^ 1], w[cur], t, LOW, r[t - 1]);	\
+	  /* the row parent is copied with w[cur][0][o], the column	\
+	     parent with w[cur][1][o] */				\
+	  for (int o = 0; o < SIDE; o++)				\
+	    {								\
+	      u[(o * NHIGH + a) * NHIGH + b] += w[cur][o];		\
+	      u[(o * NHIGH + b) * NHIGH + a] += w[cur][SIDE + o];	\
+	    }								\
+	}								\
+    double * from = u;							\
+    double * to = v;							\
+    for (int t = LOW; t < N; t++)					\
+      {									\
+	rec_fixed_high (to, from, t, N, r[t - 1]);			\
+	double * tmp = from;						\
+	from = to;							\
+	to = tmp;							\
+      }									\
+    /* either parent supplies the first locus */			\
+    for (int k = 0; k < 1 << N; k++)					\
+      freqs[k] = 0.5 * from[k];						\
+  }
+
+REC_FIXED_KERNEL(1)
+REC_FIXED_KERNEL(2)
+REC_FIXED_KERNEL(3)
+REC_FIXED_KERNEL(4)
+REC_FIXED_KERNEL(5)
+REC_FIXED_KERNEL(6)
+REC_FIXED_KERNEL(7)
+REC_FIXED_KERNEL(8)
+
+typedef void (* rec_fixed_kernel_t) (double *, double **, const double *);
+
+static const rec_fixed_kernel_t rec_fixed_kernels[REC_FIXED_MAXLOCI + 1] =
+  {
+    NULL, rec_mating_1, rec_mating_2, rec_mating_3, rec_mating_4,
+    rec_mating_5, rec_mating_6, rec_mating_7, rec_mating_8
+  };
+
+rec_fixed_t *
+rec_fixed_table (const double * r, size_t geno)
+{
+  /* the recombination map R of a genome of GENO genotypes, for the
+     kernels; returns NULL (with errno set to EINVAL) if there is no
+     kernel for a genome of that size */
+  size_t nloci = (size_t) log2 (geno);
+  if ((nloci < 1) || (nloci > REC_FIXED_MAXLOCI) || ((1 << nloci) != geno))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  rec_fixed_t * fixed = malloc (sizeof (rec_fixed_t));
+  if (fixed == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  rec_fixed_init (fixed, r, nloci);
+  return fixed;
+}
+
+void
+rec_fixed_init (rec_fixed_t * fixed, const double * r, size_t nloci)
+{
+  /* keep the map R of NLOCI loci in FIXED, or mark it as having no
+     kernel */
+  fixed->nloci = (nloci <= REC_FIXED_MAXLOCI) ? nloci : 0;
+  if (fixed->nloci > 1)
+    memcpy (fixed->r, r, (nloci - 1) * sizeof (double));
+}
+
+size_t
+rec_fixed_bytes (void)
+{
+  /* heap taken by rec_fixed_table () (see mem.c) */
+  return mem_chunk (sizeof (rec_fixed_t));
+}
+
+void
+rec_fixed_free (rec_fixed_t * fixed)
+{
+  free (fixed);
+}
+
+_Bool
+rec_fixed_mating (double * freqs, haploid_data_t * data)
+{
+  /* run the kernel for the number of loci with the map in rec_fixed
+     or, unless DATA has a packed table, with the one rec_gen_table ()
+     kept in the table; return false if the caller should fall back to
+     the general algorithm */
+  const rec_fixed_t * fixed = data->rec_fixed;
+  if ((fixed == NULL) && (data->rec_packed == NULL)
+      && (data->rec_table != NULL))
+    fixed = rec_table_fixed (data->rec_table, data->geno);
+  if ((fixed == NULL) || (fixed->nloci < 1)
+      || (fixed->nloci != data->nloci))
+    return false;
+  rec_fixed_kernels[fixed->nloci] (freqs, data->mtable, fixed->r);
+  return true;
+}
@@ -28,8 +28,22 @@
 
 */
 #include <stdlib.h>
+#include <string.h>
 #include "haploid.h"
 
+static void
+geno_superset_sum (double * freqs, size_t geno)
+{
+  /* in-place superset-sum (zeta) transform over the loci: afterwards
+     FREQS[S] holds the total frequency of all genotypes that carry the
+     set allele at every locus in S; one pass per locus, and each pass
+     is a plain add of the upper half of every block onto the lower */
+  for (size_t bit = 1; bit < geno; bit <<= 1)
+    for (size_t base = 0; base < geno; base += bit << 1)
+      for (size_t i = base; i < base + bit; i++)
+	freqs[i] += freqs[i + bit];
+}
+
 void
 allele_to_genotype (double * allele_freqs, double * geno_freqs,
 		    size_t nloci, size_t geno)
@@ -37,49 +51,71 @@ allele_to_genotype (double * allele_freqs, double * geno_freqs,
   /* take an array of allele frequencies and generate an array of
      genotype frequencies; store the result in geno_freqs */
 
-
-  for (int i = 0; i < geno; i++)
+  /* build the product by doubling: after the j-th locus the first 2^j
+     entries hold the genotype frequencies of the first j loci, and
+     adding one more locus splits every entry into an "unset" and a
+     "set" half, one multiply each */
+  geno_freqs[0] = 1.0;
+  size_t len = 1;
+  for (int j = 0; (j < nloci) && (len < geno); j++, len <<= 1)
     {
-      double p = 1.0;
-      
-      for (int j = 0; j < nloci; j++)
+      double p = allele_freqs[j];
+      double q = fdim (1.0, p);
+      for (size_t i = 0; i < len; i++)
 	{
-	  if (bits_isset (i, j))
-	    p *= allele_freqs[j];
-	  else
-	    p *= fdim(1.0, allele_freqs[j]);
+	  geno_freqs[i + len] = geno_freqs[i] * p;
+	  geno_freqs[i] *= q;
 	}
-      /* how can we ensure that we end up with frequencies that sum to
-	 one? */
-      /* divide by the total */
-      geno_freqs[i] = p;
     }
 }
 
+/* genotypes are totaled in blocks of this many; must be a power of
+   two */
+#define ALLELE_BLOCK 256
+
+/* the most loci a genotype index can hold: enough for any array of
+   allele frequencies on the stack */
+#define GENO_MAXLOCI (8 * sizeof (size_t))
+
 void
 genotype_to_allele (double * allele_freqs, double * geno_freqs,
 		    size_t nloci, size_t geno)
 {
   /* take an array of genotype frequencies geno_freqs and convert them
      to allele frequencies, store the result in allele_freqs */
-  /* loop over alleles (loci), iterating over genotypes within: if the
-     bit for that locus is set, then multiply the allele frequency for
-     the locus by the genotype frequency */
 
-  /* notice that this is the same as allele_to_genotype except for a
-     few crucial differences ... ;) */
-  for (int i = 0; i < nloci; i++)
+  /* one pass over the genotypes: the low loci (inside a block) are
+     totaled by folding every block onto one block-sized array of
+     running sums, and the high loci (which are constant inside a
+     block) get the total of each block; then the low loci are read
+     off the running sums */
+  size_t block = (geno < ALLELE_BLOCK) ? geno : ALLELE_BLOCK;
+  size_t lowloci = (size_t) log2 (block);
+  if (lowloci > nloci)
+    lowloci = nloci;
+  double acc[ALLELE_BLOCK];
+  for (size_t i = 0; i < block; i++)
+    acc[i] = 0.0;
+  for (int j = 0; j < nloci; j++)
+    allele_freqs[j] = 0.0;
+
+  for (size_t base = 0; base < geno; base += block)
     {
-      double p = 0.0;
-      
-      for (int j = 0; j < geno; j++)
+      double tot = 0.0;
+      double * g = geno_freqs + base;
+      for (size_t i = 0; i < block; i++)
 	{
-	  if (bits_isset (j, i))
-	    p += geno_freqs[j];
+	  acc[i] += g[i];
+	  tot += g[i];
 	}
-
-      allele_freqs[i] = p;
+      for (int j = lowloci; j < nloci; j++)
+	if (bits_isset (base, j))
+	  allele_freqs[j] += tot;
     }
+  for (int j = 0; j < lowloci; j++)
+    for (size_t i = 0; i < block; i++)
+      if (bits_isset (i, j))
+	allele_freqs[j] += acc[i];
 }
 
 double
@@ -90,7 +126,7 @@ ld_from_geno (double * genofreqs, size_t geno)
      element and the product of the allele frequencies making up that
      least-significant genotype */
   size_t nloci = (uint) log2 (geno);
-  double alleles[nloci];
+  double alleles[GENO_MAXLOCI];
   /* assume diallelic loci and calculate the genotype frequencies */
   genotype_to_allele (alleles, genofreqs, nloci, geno);
   double minuend = *genofreqs;
@@ -109,7 +145,7 @@ ld_sub_geno (double * genofreqs, uint loci, size_t ngeno)
   /* get "sub-genotype" frequency */
   double subgeno_freq = 0.0F;
   uint nloci = (uint) log2(ngeno);
-  double alleles[nloci];
+  double alleles[GENO_MAXLOCI];
   genotype_to_allele (alleles, genofreqs, nloci, ngeno);
   for (int i = 0; i < ngeno; i++)
     if ((i & loci) == loci) subgeno_freq += genofreqs[i];
@@ -123,3 +159,86 @@ ld_sub_geno (double * genofreqs, uint loci, size_t ngeno)
       subtrahend *= alleles[i];
   return subgeno_freq - subtrahend;  
 }
+
+void
+ld_all_geno (double * genofreqs, double * ld, size_t geno)
+{
+  /* LD[S] gets the value of ld_sub_geno (GENOFREQS, S, GENO) for every
+     mask S at once; LD may be the same array as GENOFREQS */
+  size_t nloci = (size_t) log2 (geno);
+  if (ld != genofreqs)
+    memcpy (ld, genofreqs, geno * sizeof (double));
+  /* all "sub-genotype" frequencies in one transform */
+  geno_superset_sum (ld, geno);
+  /* the singletons are now the allele frequencies */
+  double alleles[GENO_MAXLOCI];
+  for (int i = 0; i < nloci; i++)
+    alleles[i] = ld[1 << i];
+  for (size_t s = 0; s < geno; s++)
+    {
+      double subtrahend = 1.0;
+      for (int i = 0; i < nloci; i++)
+	if (bits_isset (s, i))
+	  subtrahend *= alleles[i];
+      ld[s] -= subtrahend;
+    }
+}
+
+static void
+geno_marginals_into (double * genofreqs, size_t geno, uint * masks,
+		     size_t nmasks, double ** marginals, double * super)
+{
+  /* geno_marginals () with GENO doubles of scratch in SUPER */
+
+  /* one superset-sum transform serves every mask */
+  memcpy (super, genofreqs, geno * sizeof (double));
+  geno_superset_sum (super, geno);
+
+  for (size_t q = 0; q < nmasks; q++)
+    {
+      uint mask = masks[q];
+      double * out = marginals[q];
+      size_t len = 1 << bits_popcount (mask);
+      /* gather the sub-genotype frequencies for every subset of the
+	 mask; enumerating subsets this way visits them in the order of
+	 their packed index */
+      uint sub = 0;
+      for (size_t h = 0; h < len; h++)
+	{
+	  out[h] = super[sub];
+	  sub = (sub - mask) & mask;
+	}
+      /* Moebius inversion on the small cube turns "carries at least
+	 these alleles" into "carries exactly these alleles" */
+      for (size_t bit = 1; bit < len; bit <<= 1)
+	for (size_t base = 0; base < len; base += bit << 1)
+	  for (size_t h = base; h < base + bit; h++)
+	    out[h] -= out[h + bit];
+    }
+}
+
+void
+geno_marginals (double * genofreqs, size_t geno, uint * masks,
+		size_t nmasks, double ** marginals)
+{
+  /* for each mask of loci MASKS[q], fill MARGINALS[q] with the
+     marginal haplotype frequencies over those loci: entry h of
+     MARGINALS[q] is the total frequency of genotypes that agree with
+     h at the loci in MASKS[q], where the bits of h are the loci of the
+     mask packed down in order (so MARGINALS[q] has 2^popcount
+     entries) */
+  double * super = malloc (geno * sizeof (double));
+  if (super == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  geno_marginals_into (genofreqs, geno, masks, nmasks, marginals, super);
+  free (super);
+}
+
+void
+geno_marginals_ws (double * genofreqs, uint * masks, size_t nmasks,
+		   double ** marginals, haploid_ws_t * ws)
+{
+  /* geno_marginals () for the genome size of WS, without allocating */
+  geno_marginals_into (genofreqs, ws->geno, masks, nmasks, marginals,
+		       ws->super);
+}
@@ -35,6 +35,7 @@
 #include <config.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <math.h>
 #include <limits.h>
 #include <errno.h>
@@ -49,6 +50,41 @@ struct sparse_elt_t
 };
 
 typedef sparse_elt_t rtable_t;
+
+/* what rec_validate () can find wrong with a table */
+#define REC_VALID 0		/* nothing */
+#define REC_BAD_INDEX 1		/* an index out of range, or repeated */
+#define REC_BAD_SUM 2		/* a pair's offspring do not sum to one */
+#define REC_BAD_NEGATIVE 3	/* a negative probability */
+#define REC_BAD_SYMMETRY 4	/* (K, J) and (J, K) differ for an offspring */
+typedef struct rec_check_t rec_check_t;
+struct rec_check_t
+{
+  int kind;			/* the worst violation, or REC_VALID */
+  double err;			/* its size */
+  uint target;			/* the offspring, except for REC_BAD_SUM */
+  uint k;			/* the parents */
+  uint j;
+  size_t nbad;			/* violations of every kind */
+  size_t nnz;			/* entries checked */
+};
+
+/* recombination kernels for small genomes (see fixed.c) */
+typedef struct rec_fixed_t rec_fixed_t;
+#define REC_FIXED_MAXLOCI 8
+
+/* recombination tables with a dictionary of values (see packed.c) */
+typedef struct rec_packed_t rec_packed_t;
+#define REC_PACKED_MAXLOCI 16
+
+/* recombination over the genotypes still present (see active.c) */
+typedef struct rec_active_t rec_active_t;
+
+/* recombination tables built as offspring are asked for (see lazy.c) */
+typedef struct rec_lazy_t rec_lazy_t;
+#define REC_LAZY_LRU 0		/* evict the least recently used */
+#define REC_LAZY_FIFO 1		/* evict the first built */
+
 typedef struct haploid_data_t haploid_data_t;
 struct haploid_data_t
 {
@@ -56,6 +92,290 @@ struct haploid_data_t
   size_t nloci;			/* number of loci */
   rtable_t ** rec_table;	/* recombination table */
   double ** mtable;		/* mating table (matrix) */
+  rec_fixed_t * rec_fixed;	/* map for the kernels or NULL */
+  rec_lazy_t * rec_lazy;	/* used if rec_table is NULL */
+  rec_packed_t * rec_packed;	/* packed rec_table or NULL */
+};
+
+typedef struct haploid_summary_t haploid_summary_t;
+struct haploid_summary_t
+{
+  double * alleles;		/* allele frequencies (nloci entries) */
+  double total;			/* total of the genotype frequencies */
+  double drift;			/* total - 1.0 */
+  double wbar;			/* mean fitness */
+  double dist;			/* distance to the previous generation */
+  size_t nld;			/* number of LD terms */
+  uint * ld_masks;		/* masks of loci for the LD terms */
+  double * ld;			/* LD terms (nld entries) */
+};
+
+/* sparse populations: (haplotype, frequency) pairs sorted by
+   haplotype (see spop.c) */
+#define SPOP_MAXLOCI 64
+typedef struct spop_elt_t spop_elt_t;
+struct spop_elt_t
+{
+  uint64_t id;			/* haplotype */
+  double freq;			/* its frequency */
+};
+
+typedef struct spop_t spop_t;
+struct spop_t
+{
+  size_t nloci;			/* number of loci */
+  size_t n;			/* number of haplotypes present */
+  size_t cap;			/* allocated length of elts */
+  spop_elt_t * elts;		/* the haplotypes, sorted */
+  bool sorted;			/* false after spop_add () */
+};
+
+/* a stream of counter-based random numbers (see rng.c) */
+typedef struct haploid_rng_t haploid_rng_t;
+struct haploid_rng_t
+{
+  uint64_t seed;		/* the stream, to record with results */
+  uint32_t run;
+  uint32_t trial;
+  uint32_t thread;
+  uint32_t key[2];		/* Philox key and counter */
+  uint32_t ctr[4];
+  uint32_t buf[4];		/* the current block */
+  unsigned int used;		/* words of buf already returned */
+};
+
+/* buffered output (see writer.c) */
+#define WRITER_MAXPREC 17	/* most digits writer_fixed () does itself */
+typedef struct haploid_writer_t haploid_writer_t;
+struct haploid_writer_t
+{
+  int fd;			/* where the output goes */
+  char * buf;
+  size_t size;			/* flush when this would be exceeded */
+  size_t len;			/* bytes waiting in buf */
+  int err;			/* errno of the first failed write */
+};
+
+/* binary trajectory files (see traj.c) */
+#define TRAJ_XOR 1		/* records are XOR-delta compressed */
+#define TRAJ_FITNESS 2		/* the header carries fitnesses */
+
+/* the start of a trajectory file */
+typedef struct traj_header_t traj_header_t;
+struct traj_header_t
+{
+  char magic[8];		/* "HAPTRAJ1" */
+  uint32_t byteorder;		/* 0x01020304 as written */
+  uint32_t flags;
+  uint32_t nloci;
+  uint32_t geno;
+  uint32_t every;		/* decimation used when writing */
+  uint32_t reserved;
+  double threshold;
+  uint64_t seed;
+};
+
+/* what goes in the header */
+typedef struct traj_info_t traj_info_t;
+struct traj_info_t
+{
+  size_t nloci;
+  size_t geno;
+  uint32_t flags;
+  uint32_t every;		/* keep every k-th generation (0: off) */
+  double threshold;		/* or any change above this (0: off) */
+  uint64_t seed;
+  double * r;			/* nloci - 1 recombination fractions */
+  double * W;			/* geno fitnesses, with TRAJ_FITNESS */
+};
+
+/* a trajectory being written */
+typedef struct traj_t traj_t;
+struct traj_t
+{
+  haploid_writer_t * w;
+  size_t geno;
+  uint32_t flags;
+  uint32_t every;
+  double threshold;
+  uint64_t nrec;		/* records written */
+  uint64_t last_gen;		/* the last two records written */
+  uint64_t prev_gen;
+  double * last;
+  double * prev;
+  unsigned char * buf;		/* an encoded record */
+};
+
+/* a trajectory file mapped for reading */
+typedef struct traj_map_t traj_map_t;
+struct traj_map_t
+{
+  void * base;			/* the mapping */
+  size_t size;
+  const traj_header_t * header;
+  const double * r;
+  const double * W;		/* NULL without TRAJ_FITNESS */
+  size_t nrec;
+  const uint64_t * records;	/* nrec * (geno + 1) words */
+  uint64_t * decoded;		/* records of a TRAJ_XOR file */
+};
+
+/* records written by a thread of their own (see async.c) */
+#define ASYNC_BLOCK 0		/* a full ring makes the producer wait */
+#define ASYNC_DROP 1		/* a full ring discards the record */
+typedef struct haploid_async_t haploid_async_t;
+/* formats and writes one record; nonzero on failure */
+typedef int (*async_encode_t) (const void * rec, void * arg);
+
+/* the argument of async_write_raw () */
+typedef struct async_raw_t async_raw_t;
+struct async_raw_t
+{
+  haploid_writer_t * w;
+  size_t recsize;
+};
+
+/* statistics over replicate trials (see ensemble.c) */
+typedef struct ens_stat_t ens_stat_t;
+struct ens_stat_t
+{
+  double lo;			/* the range of the bins */
+  double hi;
+  uint64_t n;			/* replicates counted */
+  double mean;
+  double m2;			/* sum of squared deviations */
+  double min;
+  double max;
+  uint64_t under;		/* below lo */
+  uint64_t over;		/* above hi */
+};
+
+typedef struct ens_t ens_t;
+struct ens_t
+{
+  size_t nstat;			/* statistics per replicate */
+  size_t nbins;			/* bins per statistic */
+  ens_stat_t * stats;
+  uint64_t * bins;		/* nstat * nbins counts */
+};
+
+/* instrumentation, with --enable-stats (see stats.c) */
+#define STATS_TABLE_NNZ 0	/* recombination table entries built */
+#define STATS_GENERATIONS 1	/* generations computed */
+#define STATS_MAT_TOT 2		/* calls to sparse_mat_tot () */
+#define STATS_ALLOCS 3		/* allocations for tables */
+#define STATS_NCOUNTERS 4
+
+#define STATS_STAGE_TABLE 0	/* building recombination tables */
+#define STATS_STAGE_MTABLE 1	/* filling mating tables */
+#define STATS_STAGE_RECOMB 2	/* recombination */
+#define STATS_STAGE_SELECT 3	/* selection */
+#define STATS_STAGE_CONVERGE 4	/* checking for convergence */
+#define STATS_STAGE_USER 5	/* timed by the caller */
+#define STATS_NSTAGES 6
+
+typedef struct haploid_stats_t haploid_stats_t;
+struct haploid_stats_t
+{
+  uint64_t count[STATS_NCOUNTERS];
+  uint64_t stage_ns[STATS_NSTAGES];	/* time in each stage */
+  uint64_t stage_calls[STATS_NSTAGES];
+};
+
+/* individual-based populations of bit-packed genomes (see ibm.c) */
+typedef struct ibm_t ibm_t;
+struct ibm_t
+{
+  size_t nloci;			/* number of loci */
+  size_t nwords;		/* 64-bit words per genome */
+  size_t n;			/* number of individuals */
+  uint32_t * rthresh;		/* recombination map as 32-bit thresholds */
+  uint64_t * genomes;		/* n * nwords words */
+  uint64_t * next;		/* the offspring generation */
+  double * prob;		/* alias table for fitness */
+  uint32_t * alias;
+  uint32_t * work;
+  double rlog;			/* log (1 - largest r), or NAN to draw a
+				   word for every interval */
+  uint32_t * rbuf;		/* random words for a block of offspring */
+  uint32_t * parents;		/* the parents of the block */
+  uint64_t * switches;		/* the crossovers of one offspring */
+};
+
+/* the memory a model needs or holds, in bytes (see mem.c) */
+typedef struct haploid_mem_t haploid_mem_t;
+struct haploid_mem_t
+{
+  size_t nnz;			/* recombination table entries */
+  size_t list;			/* as made by rec_gen_table () */
+  size_t fixed;			/* a map (rec_fixed_table), or 0 */
+  size_t mtable;		/* one mating table (rmtable) */
+  size_t lazy;			/* a lazy table (rec_lazy_new) */
+  size_t packed;		/* packed (rec_packed_table), or 0 */
+};
+
+/* scratch space for the generations of one genome size, so that they
+   allocate nothing (see ws.c) */
+typedef struct haploid_ws_t haploid_ws_t;
+struct haploid_ws_t
+{
+  size_t nloci;			/* number of loci */
+  size_t geno;			/* number of genotypes */
+  double ** mtable;		/* a mating table, its rows in one block */
+  double * super;		/* GENO sums for geno_marginals_ws () */
+};
+
+/* the tables of a model, shared by any number of threads, and the
+   state of one population of it (see model.c) */
+typedef struct haploid_model_t haploid_model_t;
+typedef struct haploid_pop_t haploid_pop_t;
+struct haploid_pop_t
+{
+  haploid_model_t * model;	/* a reference, dropped by pop_free () */
+  haploid_data_t data;		/* the model's tables, our mating table */
+  haploid_ws_t * ws;
+  double * freqs;		/* genotype frequencies */
+};
+
+/* independent trials run by threads that steal work from each other
+   (see exec.c) */
+#define EXEC_DONE 0		/* the trial is finished */
+#define EXEC_YIELD 1		/* run the trial again later */
+typedef struct haploid_exec_t haploid_exec_t;
+typedef struct exec_ctx_t exec_ctx_t;
+struct exec_ctx_t
+{
+  size_t trial;			/* the trial to advance */
+  size_t worker;		/* the thread running it */
+  haploid_rng_t * rng;		/* the trial's own stream */
+  haploid_ws_t * ws;		/* the worker's workspace, or NULL */
+  void * result;		/* the trial's slot in the results */
+};
+/* advances a trial; returns EXEC_DONE, EXEC_YIELD or a failure */
+typedef int (* exec_task_t) (exec_ctx_t * ctx, void * arg);
+
+/* simulations that run for a budget and resume (see sim.c) */
+#define SIM_BUDGET 0		/* the budget ran out; it may resume */
+#define SIM_CONVERGED 1		/* generations stopped changing */
+#define SIM_FIXED 2		/* one genotype has taken over */
+typedef struct haploid_sim_t haploid_sim_t;
+/* fills a mating table for genotype frequencies FREQS */
+typedef void (* sim_mating_t) (double ** mtable, const double * freqs,
+			       size_t geno, void * arg);
+/* called after each generation */
+typedef void (* sim_observe_t) (const haploid_sim_t * sim, void * arg);
+struct haploid_sim_t
+{
+  haploid_pop_t * pop;		/* the population and its model */
+  const double * W;		/* fitnesses, or NULL */
+  double tol;			/* for convergence */
+  double fixed;			/* a genotype this near 1 has fixed */
+  sim_mating_t mating;		/* NULL for random mating */
+  sim_observe_t observe;	/* or NULL */
+  void * arg;			/* for mating and observe */
+  double * prev;		/* the previous generation */
+  uint64_t gens;		/* generations run */
+  int status;
 };
 
 /* spec_funcs.c */
@@ -72,6 +392,126 @@ rec_mating (double * freqs, haploid_data_t * data);
 rtable_t **
 rec_gen_table (double * r, size_t geno);
 
+void
+rec_free_table (rtable_t ** rtable, size_t geno);
+
+int
+rec_validate (rtable_t ** rtable, size_t geno, double tol, rec_check_t * check);
+
+/* active.c */
+rec_active_t *
+rec_active_new (rtable_t ** rtable, size_t geno, double threshold);
+
+void
+rec_active_free (rec_active_t * a);
+
+void
+rec_active_reset (rec_active_t * a, const double * freqs);
+
+size_t
+rec_active_count (const rec_active_t * a);
+
+double
+rec_active_mating (double * freqs, double ** mtable, rec_active_t * a);
+
+/* async.c */
+haploid_async_t *
+async_new (size_t recsize, size_t nslots, int policy,
+	   async_encode_t encode, void * arg);
+
+void *
+async_reserve (haploid_async_t * a);
+
+void
+async_commit (haploid_async_t * a);
+
+int
+async_push (haploid_async_t * a, const void * rec);
+
+uint64_t
+async_dropped (haploid_async_t * a);
+
+int
+async_free (haploid_async_t * a);
+
+int
+async_write_raw (const void * rec, void * arg);
+
+int
+async_write_traj (const void * rec, void * arg);
+
+/* drift.c */
+void
+drift_multinomial (unsigned long n, double * p, size_t len,
+		   unsigned long * counts, haploid_rng_t * rng);
+
+int
+drift_wf (double * freqs, size_t geno, unsigned long N,
+	  haploid_rng_t * rng);
+
+int
+drift_wf_batch (double * freqs, size_t geno, size_t nrep,
+		unsigned long N, haploid_rng_t * rng);
+
+/* ensemble.c */
+ens_t *
+ens_new (size_t nstat, size_t nbins, const double * lo, const double * hi);
+
+void
+ens_free (ens_t * e);
+
+void
+ens_add (ens_t * e, const double * x);
+
+int
+ens_merge (ens_t * into, const ens_t * from);
+
+uint64_t
+ens_count (const ens_t * e, size_t i);
+
+double
+ens_mean (const ens_t * e, size_t i);
+
+double
+ens_var (const ens_t * e, size_t i);
+
+double
+ens_quantile (const ens_t * e, size_t i, double q);
+
+size_t
+ens_size (const ens_t * e);
+
+int
+ens_write (haploid_writer_t * w, const ens_t * e);
+
+ens_t *
+ens_read (const void * buf, size_t len);
+
+/* exec.c */
+haploid_exec_t *
+exec_new (size_t nthreads, size_t nloci);
+
+void
+exec_free (haploid_exec_t * exec);
+
+size_t
+exec_nthreads (const haploid_exec_t * exec);
+
+size_t
+exec_run (haploid_exec_t * exec, size_t ntrials, exec_task_t task,
+	  void * arg, uint64_t seed, void * results, size_t resultsize);
+
+void
+exec_counts (const haploid_exec_t * exec, uint64_t * steals,
+	     uint64_t * yields);
+
+/* fixed.c */
+rec_fixed_t *
+rec_fixed_table (const double * r, size_t geno);
+
+void
+rec_fixed_free (rec_fixed_t * fixed);
+
 /* geno_func.c */
 void
 allele_to_genotype (double * allele_freqs, double * geno_freqs,
@@ -87,9 +527,272 @@ ld_from_geno (double * genofreqs, size_t geno);
 double
 ld_sub_geno (double * genofreqs, uint loci, size_t ngeno);
 
+void
+ld_all_geno (double * genofreqs, double * ld, size_t geno);
+
+void
+geno_marginals (double * genofreqs, size_t geno, uint * masks,
+		size_t nmasks, double ** marginals);
+
+void
+geno_marginals_ws (double * genofreqs, uint * masks, size_t nmasks,
+		   double ** marginals, haploid_ws_t * ws);
+
+/* ibm.c */
+ibm_t *
+ibm_new (size_t nloci, size_t n, double * r);
+
+void
+ibm_free (ibm_t * pop);
+
+void
+ibm_from_freqs (ibm_t * pop, double * freqs, size_t geno,
+		haploid_rng_t * rng);
+
+void
+ibm_freqs (ibm_t * pop, double * freqs, size_t geno);
+
+int
+ibm_generation (ibm_t * pop, double * W, haploid_rng_t * rng);
+
+/* lazy.c */
+rec_lazy_t *
+rec_lazy_new (const double * r, size_t geno, size_t capacity, int policy);
+
+void
+rec_lazy_free (rec_lazy_t * lazy);
+
+rtable_t *
+rec_lazy_get (rec_lazy_t * lazy, uint target);
+
+double
+rec_lazy_offspring (rec_lazy_t * lazy, double ** mtable, uint target);
+
+void
+rec_lazy_counts (const rec_lazy_t * lazy, uint64_t * hits,
+		 uint64_t * misses);
+
+/* mem.c */
+size_t
+mem_nnz (size_t nloci, const double * r);
+
+int
+mem_estimate (size_t nloci, const double * r, haploid_mem_t * mem);
+
+void
+mem_usage (const haploid_data_t * data, haploid_mem_t * mem);
+
+/* model.c */
+haploid_model_t *
+model_new (size_t nloci, const double * r);
+
+haploid_model_t *
+model_ref (haploid_model_t * model);
+
+void
+model_unref (haploid_model_t * model);
+
+size_t
+model_refs (const haploid_model_t * model);
+
+haploid_data_t
+model_data (const haploid_model_t * model);
+
+const double *
+model_map (const haploid_model_t * model);
+
+haploid_pop_t *
+pop_new (haploid_model_t * model, const double * freqs);
+
+void
+pop_free (haploid_pop_t * pop);
+
+double
+pop_select (haploid_pop_t * pop, const double * W);
+
+double
+pop_generation (haploid_pop_t * pop, const double * W);
+
+/* packed.c */
+rec_packed_t *
+rec_packed_table (rtable_t ** rtable, size_t geno);
+
+void
+rec_packed_free (rec_packed_t * packed);
+
+size_t
+rec_packed_values (const rec_packed_t * packed);
+
+/* rng.c */
+void
+rng_philox (const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+
+void
+rng_init (haploid_rng_t * rng, uint64_t seed, uint32_t run, uint32_t trial,
+	  uint32_t thread);
+
+uint64_t
+rng_seed (void);
+
+uint32_t
+rng_u32 (haploid_rng_t * rng);
+
+double
+rng_uniform (haploid_rng_t * rng);
+
+void
+rng_fill_u32 (haploid_rng_t * rng, uint32_t * out, size_t n);
+
+void
+rng_fill_uniform (haploid_rng_t * rng, double * out, size_t n);
+
+unsigned long
+rng_binomial (haploid_rng_t * rng, unsigned long n, double p);
+
+void
+rng_fill_binomial (haploid_rng_t * rng, unsigned long n, double * p,
+		   size_t len, unsigned long * out);
+
+/* sim.c */
+haploid_sim_t *
+sim_new (haploid_model_t * model, const double * freqs, const double * W,
+	 double tol);
+
+void
+sim_free (haploid_sim_t * sim);
+
+int
+sim_run_for (haploid_sim_t * sim, uint64_t max_gens, double max_seconds);
+
+/* spop.c */
+spop_t *
+spop_new (size_t nloci);
+
+void
+spop_free (spop_t * pop);
+
+void
+spop_add (spop_t * pop, uint64_t id, double freq);
+
+double
+spop_get (spop_t * pop, uint64_t id);
+
+spop_t *
+spop_from_dense (double * freqs, size_t geno);
+
+void
+spop_to_dense (spop_t * pop, double * freqs, size_t geno);
+
+double
+spop_prune (spop_t * pop, double threshold);
+
+double
+spop_select (spop_t * pop, double (* fitness) (uint64_t id, void * arg),
+	     void * arg);
+
+double
+spop_mutate (spop_t * pop, double * mu, double threshold);
+
+double
+spop_recombine (spop_t * pop, double * r, double threshold);
+
+/* stats.c */
+_Bool
+stats_enabled (void);
+
+void
+stats_begin (int stage);
+
+void
+stats_end (int stage);
+
+void
+stats_get (haploid_stats_t * stats);
+
+void
+stats_get_thread (haploid_stats_t * stats);
+
+void
+stats_reset (void);
+
+const char *
+stats_stage_name (int stage);
+
+int
+stats_trace_open (const char * path);
+
+int
+stats_trace_close (void);
+
+/* summary.c */
+void
+haploid_summarize (double * freqs, double * prev, double * W,
+		   size_t geno, haploid_summary_t * summary);
+
+/* traj.c */
+traj_t *
+traj_open (haploid_writer_t * w, const traj_info_t * info);
+
+int
+traj_record (traj_t * t, uint64_t gen, const double * freqs);
+
+int
+traj_final (traj_t * t, uint64_t gen, const double * freqs);
+
+int
+traj_close (traj_t * t);
+
+traj_map_t *
+traj_map (const char * path);
+
+void
+traj_unmap (traj_map_t * map);
+
+const double *
+traj_get (const traj_map_t * map, size_t i, uint64_t * gen);
+
+/* writer.c */
+haploid_writer_t *
+writer_new (int fd, size_t size);
+
+int
+writer_flush (haploid_writer_t * w);
+
+int
+writer_free (haploid_writer_t * w);
+
+int
+writer_bytes (haploid_writer_t * w, const void * data, size_t n);
+
+int
+writer_char (haploid_writer_t * w, char c);
+
+int
+writer_str (haploid_writer_t * w, const char * s);
+
+int
+writer_printf (haploid_writer_t * w, const char * format, ...);
+
+int
+writer_fixed (haploid_writer_t * w, double x, int width, int prec,
+	      _Bool left);
+
+/* ws.c */
+haploid_ws_t *
+ws_new (size_t nloci);
+
+void
+ws_free (haploid_ws_t * ws);
+
 /* mating.c */
 double **
-rmtable (size_t geno, double * freq);
+rmtable (double * freq, size_t geno);
+
+void
+rmtable_fill (double ** table, const double * freq, size_t geno);
+
+double **
+rmtable_ws (const double * freq, haploid_ws_t * ws);
 
 /* bits.c: useful functions for integers */
 
@@ -0,0 +1,357 @@
+/*
+
+  ibm.c: individual-based simulation with bit-packed genomes
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Each haploid genome is an array of 64-bit words with bit i of the
+   genome being locus i, the same convention as genotype indices in the
+   rest of the library; for genomes of up to 64 loci the genome *is*
+   its genotype index.  Bits of the last word beyond the last locus
+   must be zero.
+
+   A generation is Wright-Fisher with selection: every offspring draws
+   two parents with probability proportional to fitness (from an alias
+   table, so each draw is O(1)), and a segregation mask M saying which
+   loci come from the first parent.  The offspring is then
+   (A & M) | (B & ~M), word by word.
+
+   The mask is built a word at a time from the crossovers, kept as
+   words of switches: bit i is set when there is a crossover after
+   locus i.  Bit i of the mask is the parity of the switches before
+   locus i, so the mask is the prefix XOR of the switches (six shifts)
+   without the switches themselves, flipped if the previous words held
+   an odd number of them or the first locus comes from the other
+   parent.  Nothing is carried from one locus to the next.
+
+   There are two ways to find the switches.  When every recombination
+   fraction is small (at most IBM_SPARSE_R), crossovers are few, and
+   drawing a random word for each interval would cost far more than
+   placing them: the gaps between candidate crossovers are geometric
+   with the largest fraction RMAX, and a candidate at interval i is
+   kept with probability r[i] / RMAX, so a genome takes about
+   1 + sum (r) pairs of draws.  Otherwise each interval gets a random
+   word, compared with its fraction; the comparisons of a word are
+   independent of each other.
+
+   Offspring are made IBM_BLOCK at a time: the random words for the
+   parents of the whole block (and the words for its intervals, if
+   drawn) come from one call to rng_fill_u32 (), and the parents of the
+   block are drawn before any mask is built. */
+
+#include <string.h>
+#include <assert.h>
+#include "haploid.h"
+#include "stats.h"
+
+/* random words used per offspring, besides one per locus: two for
+   each parent and one for the parent of the first locus */
+#define IBM_EXTRA_WORDS 5
+/* offspring made at once */
+#define IBM_BLOCK 32
+/* the largest recombination fraction for which crossovers are placed
+   by their gaps rather than drawn interval by interval */
+#define IBM_SPARSE_R 0.25
+
+ibm_t *
+ibm_new (size_t nloci, size_t n, double * r)
+{
+  /* a population of N genomes of NLOCI loci (all zero) with
+     recombination map R (NLOCI - 1 entries, copied) */
+  if ((n == 0) || (nloci == 0) || (n > UINT32_MAX))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  ibm_t * pop = malloc (sizeof (ibm_t));
+  if (pop == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  pop->nloci = nloci;
+  pop->nwords = (nloci + 63) / 64;
+  pop->n = n;
+  pop->rthresh = malloc (nloci * sizeof (uint32_t));
+  pop->genomes = calloc (n * pop->nwords, sizeof (uint64_t));
+  pop->next = malloc (n * pop->nwords * sizeof (uint64_t));
+  pop->prob = malloc (n * sizeof (double));
+  pop->alias = malloc (n * sizeof (uint32_t));
+  pop->work = malloc (n * sizeof (uint32_t));
+  pop->parents = malloc (2 * IBM_BLOCK * sizeof (uint32_t));
+  pop->switches = malloc (pop->nwords * sizeof (uint64_t));
+  double rmax = 0.0;
+  for (size_t i = 0; i + 1 < nloci; i++)
+    rmax = fmax (rmax, r[i]);
+  /* zero when there are no crossovers at all */
+  pop->rlog = (rmax <= IBM_SPARSE_R) ? log1p (-rmax) : NAN;
+  size_t len = isnan (pop->rlog) ? nloci + IBM_EXTRA_WORDS : IBM_EXTRA_WORDS;
+  pop->rbuf = malloc (IBM_BLOCK * len * sizeof (uint32_t));
+  if ((pop->rthresh == NULL) || (pop->genomes == NULL) || (pop->next == NULL)
+      || (pop->prob == NULL) || (pop->alias == NULL) || (pop->work == NULL)
+      || (pop->rbuf == NULL) || (pop->parents == NULL)
+      || (pop->switches == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  /* a crossover in interval i happens (or a candidate there is kept)
+     when 32 random bits fall below RTHRESH[i]; the last entry is never
+     used */
+  for (size_t i = 0; i + 1 < nloci; i++)
+    {
+      double p = isnan (pop->rlog) ? r[i] : (rmax > 0.0) ? r[i] / rmax : 0.0;
+      pop->rthresh[i] = (uint32_t) fmin (ldexp (p, 32), UINT32_MAX);
+    }
+  pop->rthresh[nloci - 1] = 0;
+  return pop;
+}
+
+void
+ibm_free (ibm_t * pop)
+{
+  if (pop == NULL)
+    return;
+  free (pop->rthresh);
+  free (pop->genomes);
+  free (pop->next);
+  free (pop->prob);
+  free (pop->alias);
+  free (pop->work);
+  free (pop->rbuf);
+  free (pop->parents);
+  free (pop->switches);
+  free (pop);
+}
+
+void
+ibm_from_freqs (ibm_t * pop, double * freqs, size_t geno,
+		haploid_rng_t * rng)
+{
+  /* fill POP with a multinomial sample from the genotype frequencies
+     FREQS */
+  size_t nwords = pop->nwords;
+  uint64_t * g = pop->genomes;
+  unsigned long n = pop->n;
+  double rest = 0.0;
+  for (size_t i = 0; i < geno; i++)
+    rest += freqs[i];
+  memset (g, 0, pop->n * nwords * sizeof (uint64_t));
+  for (size_t i = 0; (i < geno) && (n > 0); i++)
+    {
+      unsigned long count = (i == geno - 1) ? n
+	: rng_binomial (rng, n, freqs[i] / rest);
+      for (unsigned long c = 0; c < count; c++, g += nwords)
+	g[0] = i;
+      n -= count;
+      rest -= freqs[i];
+    }
+}
+
+void
+ibm_freqs (ibm_t * pop, double * freqs, size_t geno)
+{
+  /* summarize POP as genotype frequencies in the usual layout; only
+     the first log2 (GENO) loci are counted */
+  for (size_t i = 0; i < geno; i++)
+    freqs[i] = 0.0;
+  uint64_t mask = geno - 1;
+  const uint64_t * g = pop->genomes;
+  for (size_t k = 0; k < pop->n; k++, g += pop->nwords)
+    freqs[g[0] & mask] += 1.0;
+  for (size_t i = 0; i < geno; i++)
+    freqs[i] /= pop->n;
+}
+
+static void
+ibm_alias (ibm_t * pop, double * W)
+{
+  /* Vose's alias table for drawing individuals in proportion to their
+     fitness W[genotype] */
+  size_t n = pop->n;
+  double * prob = pop->prob;
+  uint32_t * alias = pop->alias;
+  uint32_t * work = pop->work;
+  const uint64_t * g = pop->genomes;
+  double total = 0.0;
+  for (size_t k = 0; k < n; k++)
+    total += prob[k] = W[g[k * pop->nwords]];
+  assert (isgreater (total, 0.0));
+  /* small entries fill WORK from the front, large ones from the
+     back */
+  size_t nsmall = 0, nlarge = n;
+  for (size_t k = 0; k < n; k++)
+    {
+      prob[k] *= n / total;
+      if (prob[k] < 1.0)
+	work[nsmall++] = k;
+      else
+	work[--nlarge] = k;
+    }
+  size_t s = 0, l = nlarge;
+  while ((s < nsmall) && (l < n))
+    {
+      uint32_t small = work[s++];
+      uint32_t large = work[l];
+      alias[small] = large;
+      prob[large] -= 1.0 - prob[small];
+      if (prob[large] < 1.0)
+	{
+	  /* the large entry has become small: it takes the place of the
+	     small one just finished */
+	  work[--s] = large;
+	  l++;
+	}
+    }
+  /* what is left is one up to rounding */
+  for (; s < nsmall; s++)
+    prob[work[s]] = 1.0;
+  for (; l < n; l++)
+    prob[work[l]] = 1.0;
+}
+
+static inline uint32_t
+ibm_draw (const ibm_t * pop, _Bool weighted, const uint32_t * words)
+{
+  /* one parent, from two random words */
+  uint32_t k = ((uint64_t) words[0] * pop->n) >> 32;
+  if (!weighted)
+    return k;
+  double u = ldexp (words[1], -32);
+  return (u < pop->prob[k]) ? k : pop->alias[k];
+}
+
+static inline uint64_t
+ibm_prefix_xor (uint64_t x)
+{
+  /* bit i of the result is the parity of bits 0 to i of X */
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+static void
+ibm_switches (ibm_t * pop, const uint32_t * cross, haploid_rng_t * rng)
+{
+  /* the crossovers of one offspring, in POP->switches: from a random
+     word for each interval in CROSS, or else placed by their gaps */
+  size_t nloci = pop->nloci;
+  const uint32_t * rthresh = pop->rthresh;
+  uint64_t * sw = pop->switches;
+  if (isnan (pop->rlog))
+    {
+      for (size_t w = 0; w < pop->nwords; w++)
+	{
+	  size_t bits = (nloci - 64 * w < 64) ? nloci - 64 * w : 64;
+	  const uint32_t * c = cross + 64 * w;
+	  const uint32_t * t = rthresh + 64 * w;
+	  uint64_t s = 0;
+	  for (size_t i = 0; i < bits; i++)
+	    s |= (uint64_t) (c[i] < t[i]) << i;
+	  sw[w] = s;
+	}
+      return;
+    }
+  memset (sw, 0, pop->nwords * sizeof (uint64_t));
+  if (pop->rlog == 0.0)
+    return;
+  /* candidates at intervals 0 to NLOCI - 2, the gap before each
+     geometric with log (U) / log (1 - RMAX), U in (0, 1) */
+  double at = 0.0;
+  for (;;)
+    {
+      double u = (rng_u32 (rng) + 0.5) * 0x1.0p-32;
+      at += floor (log (u) / pop->rlog);
+      if (!(at < nloci - 1))
+	return;
+      size_t i = at;
+      sw[i / 64] |= (uint64_t) (rng_u32 (rng) < rthresh[i]) << (i % 64);
+      at += 1.0;
+    }
+}
+
+int
+ibm_generation (ibm_t * pop, double * W, haploid_rng_t * rng)
+{
+  /* one generation of selection (fitnesses W indexed by genotype, or
+     NULL for none), random mating and recombination */
+  size_t nwords = pop->nwords;
+  size_t nloci = pop->nloci;
+  /* the words of each offspring in the block, and where the words
+     for the intervals start if they are drawn */
+  size_t len = IBM_EXTRA_WORDS;
+  size_t ncross = isnan (pop->rlog) ? nloci : 0;
+  uint32_t * words = pop->rbuf;
+  const uint64_t * sw = pop->switches;
+  uint32_t * parents = pop->parents;
+  _Bool weighted = (W != NULL);
+  /* the genotype indexing W is the first word of a genome */
+  if (weighted && (nloci > 64))
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  STATS_ADD (STATS_GENERATIONS, 1);
+  if (weighted)
+    {
+      STATS_BEGIN (STATS_STAGE_SELECT);
+      ibm_alias (pop, W);
+      STATS_END (STATS_STAGE_SELECT);
+    }
+
+  uint64_t * child = pop->next;
+  for (size_t k0 = 0; k0 < pop->n; k0 += IBM_BLOCK)
+    {
+      size_t nb = (pop->n - k0 < IBM_BLOCK) ? pop->n - k0 : IBM_BLOCK;
+      rng_fill_u32 (rng, words, nb * (len + ncross));
+      for (size_t i = 0; i < nb; i++)
+	{
+	  parents[2 * i] = ibm_draw (pop, weighted, words + i * len);
+	  parents[2 * i + 1] = ibm_draw (pop, weighted, words + i * len + 2);
+	}
+      for (size_t i = 0; i < nb; i++, child += nwords)
+	{
+	  const uint32_t * own = words + i * len;
+	  const uint64_t * a = pop->genomes + parents[2 * i] * nwords;
+	  const uint64_t * b = pop->genomes + parents[2 * i + 1] * nwords;
+	  ibm_switches (pop, words + nb * len + i * ncross, rng);
+	  /* all ones while the mask takes from A */
+	  uint64_t state = - (uint64_t) (own[4] & 1);
+	  for (size_t w = 0; w < nwords; w++)
+	    {
+	      uint64_t s = sw[w];
+	      uint64_t p = ibm_prefix_xor (s);
+	      uint64_t m = state ^ p ^ s;
+	      child[w] = (a[w] & m) | (b[w] & ~m);
+	      state ^= - (p >> 63);
+	    }
+	}
+    }
+  /* the offspring are the next generation */
+  uint64_t * tmp = pop->genomes;
+  pop->genomes = pop->next;
+  pop->next = tmp;
+  return 0;
+}
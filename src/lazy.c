@@ -0,0 +1,284 @@
+/*
+
+  lazy.c: recombination tables built one offspring at a time
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A lazy table holds the slice of the recombination table for an
+   offspring genotype (the list rec_gen_table () would put in
+   rtable[target]) only once that offspring is asked for, and keeps at
+   most a fixed number of slices.  Every offspring has the same number
+   of possible parents (see mem_nnz ()), so every slice fits in a slot
+   of the same size, allocated once and reused when its slice is
+   evicted.  The slots form a list from the most recently used (or,
+   with REC_LAZY_FIFO, inserted) to the least, which is evicted first.
+
+   A slice is built without searching for transposes: parent K can
+   contribute the offspring's allele wherever it carries it, so parent
+   J must carry it everywhere else, and J ^ TARGET runs over the
+   submasks of those loci only. */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "haploid.h"
+#include "sparse.h"
+#include "stats.h"
+
+#define REC_LAZY_NONE SIZE_MAX
+
+typedef struct rec_lazy_slot_t rec_lazy_slot_t;
+struct rec_lazy_slot_t
+{
+  size_t target;		/* the offspring whose slice this is */
+  size_t prev;			/* the slot used (or inserted) after */
+  size_t next;			/* the slot used before */
+  rec_node_t * nodes;		/* LEN elements, or NULL until used */
+};
+
+struct rec_lazy_t
+{
+  size_t nloci;
+  size_t geno;
+  double * r;			/* a copy of the recombination map */
+  int policy;
+  size_t len;			/* elements in a slice */
+  size_t nslots;
+  size_t used;			/* slots holding a slice */
+  rec_lazy_slot_t * slots;
+  size_t * slot_of;		/* GENO slots, or REC_LAZY_NONE */
+  size_t head;			/* most recently used */
+  size_t tail;			/* next to be evicted */
+  uint64_t hits;
+  uint64_t misses;
+};
+
+static size_t
+rec_lazy_slot_bytes (size_t len)
+{
+  return mem_chunk (len * sizeof (rec_node_t));
+}
+
+rec_lazy_t *
+rec_lazy_new (const double * r, size_t geno, size_t capacity, int policy)
+{
+  /* a lazy table for GENO genotypes and recombination map R, caching
+     as many slices as fit in CAPACITY bytes (at least one; all of them
+     if CAPACITY is 0) */
+  size_t nloci = (size_t) log2 (geno);
+  if ((nloci < 1) || (((size_t) 1 << nloci) != geno)
+      || ((policy != REC_LAZY_LRU) && (policy != REC_LAZY_FIFO)))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  rec_lazy_t * lazy = malloc (sizeof (rec_lazy_t));
+  if (lazy == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  lazy->nloci = nloci;
+  lazy->geno = geno;
+  lazy->policy = policy;
+  lazy->r = malloc (nloci * sizeof (double));
+  if (lazy->r == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  memcpy (lazy->r, r, (nloci - 1) * sizeof (double));
+  lazy->len = mem_nnz (nloci, r) / geno;
+
+  size_t slot = rec_lazy_slot_bytes (lazy->len);
+  lazy->nslots = (capacity == 0) ? geno : capacity / slot;
+  if (lazy->nslots < 1)
+    lazy->nslots = 1;
+  else if (lazy->nslots > geno)
+    lazy->nslots = geno;
+  lazy->slots = malloc (lazy->nslots * sizeof (rec_lazy_slot_t));
+  lazy->slot_of = malloc (geno * sizeof (size_t));
+  if ((lazy->slots == NULL) || (lazy->slot_of == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  for (size_t i = 0; i < lazy->nslots; i++)
+    lazy->slots[i].nodes = NULL;
+  for (size_t k = 0; k < geno; k++)
+    lazy->slot_of[k] = REC_LAZY_NONE;
+  lazy->used = 0;
+  lazy->head = lazy->tail = REC_LAZY_NONE;
+  lazy->hits = lazy->misses = 0;
+  return lazy;
+}
+
+void
+rec_lazy_free (rec_lazy_t * lazy)
+{
+  if (lazy == NULL)
+    return;
+  for (size_t i = 0; i < lazy->nslots; i++)
+    free (lazy->slots[i].nodes);
+  free (lazy->slots);
+  free (lazy->slot_of);
+  free (lazy->r);
+  free (lazy);
+}
+
+static void
+rec_lazy_unlink (rec_lazy_t * lazy, size_t i)
+{
+  rec_lazy_slot_t * slot = lazy->slots + i;
+  if (slot->prev == REC_LAZY_NONE)
+    lazy->head = slot->next;
+  else
+    lazy->slots[slot->prev].next = slot->next;
+  if (slot->next == REC_LAZY_NONE)
+    lazy->tail = slot->prev;
+  else
+    lazy->slots[slot->next].prev = slot->prev;
+}
+
+static void
+rec_lazy_push (rec_lazy_t * lazy, size_t i)
+{
+  /* make slot I the most recently used */
+  rec_lazy_slot_t * slot = lazy->slots + i;
+  slot->prev = REC_LAZY_NONE;
+  slot->next = lazy->head;
+  if (lazy->head == REC_LAZY_NONE)
+    lazy->tail = i;
+  else
+    lazy->slots[lazy->head].prev = i;
+  lazy->head = i;
+}
+
+static void
+rec_lazy_build (rec_lazy_t * lazy, rec_node_t * nodes, uint target)
+{
+  /* fill NODES with the slice for TARGET, grouped by K as in
+     rec_gen_table () */
+  STATS_BEGIN (STATS_STAGE_TABLE);
+  uint mask = lazy->geno - 1;
+  size_t n = 0;
+  for (uint k = 0; k < lazy->geno; k++)
+    {
+      uint loose = mask & ~(k ^ target);
+      uint s = 0;
+      do
+	{
+	  uint j = target ^ s;
+	  double total = rec_total (k, j, target, lazy->r, lazy->nloci);
+	  if (isgreater (total, 0.0))
+	    {
+	      assert (n < lazy->len);
+	      rec_node_t * node = nodes + n++;
+	      node->indices[0] = k;
+	      node->indices[1] = j;
+	      node->elt.indices = node->indices;
+	      node->elt.val = total;
+	      node->elt.next = &node[1].elt;
+	    }
+	  /* the next submask of LOOSE */
+	  s = (s - loose) & loose;
+	}
+      while (s != 0);
+    }
+  /* every slice has the entry for J == K == TARGET */
+  nodes[n - 1].elt.next = NULL;
+  STATS_ADD (STATS_TABLE_NNZ, n);
+  STATS_END (STATS_STAGE_TABLE);
+}
+
+rtable_t *
+rec_lazy_get (rec_lazy_t * lazy, uint target)
+{
+  /* the slice for TARGET, built if it is not cached; it stays valid
+     until a later call evicts it */
+  size_t i = lazy->slot_of[target];
+  if (i != REC_LAZY_NONE)
+    {
+      lazy->hits++;
+      if ((lazy->policy == REC_LAZY_LRU) && (lazy->head != i))
+	{
+	  rec_lazy_unlink (lazy, i);
+	  rec_lazy_push (lazy, i);
+	}
+      return &lazy->slots[i].nodes[0].elt;
+    }
+
+  lazy->misses++;
+  if (lazy->used < lazy->nslots)
+    {
+      i = lazy->used++;
+      lazy->slots[i].nodes = malloc (lazy->len * sizeof (rec_node_t));
+      if (lazy->slots[i].nodes == NULL)
+	error (0, ENOMEM, "Null pointer\n");
+      STATS_ADD (STATS_ALLOCS, 1);
+    }
+  else
+    {
+      i = lazy->tail;
+      rec_lazy_unlink (lazy, i);
+      lazy->slot_of[lazy->slots[i].target] = REC_LAZY_NONE;
+    }
+  rec_lazy_build (lazy, lazy->slots[i].nodes, target);
+  lazy->slots[i].target = target;
+  lazy->slot_of[target] = i;
+  rec_lazy_push (lazy, i);
+  return &lazy->slots[i].nodes[0].elt;
+}
+
+double
+rec_lazy_offspring (rec_lazy_t * lazy, double ** mtable, uint target)
+{
+  /* the frequency of TARGET among the offspring of mating table
+     MTABLE */
+  return sparse_mat_tot (lazy->geno, mtable, rec_lazy_get (lazy, target));
+}
+
+void
+rec_lazy_counts (const rec_lazy_t * lazy, uint64_t * hits,
+		 uint64_t * misses)
+{
+  *hits = lazy->hits;
+  *misses = lazy->misses;
+}
+
+size_t
+rec_lazy_size (size_t geno, size_t len, size_t nslots, size_t used)
+{
+  /* heap taken by a lazy table for GENO genotypes with NSLOTS slots of
+     LEN elements, USED of them holding a slice (see mem.c) */
+  size_t nloci = (size_t) log2 (geno);
+  size_t slot = rec_lazy_slot_bytes (len);
+  if ((len > SIZE_MAX / sizeof (rec_node_t)) || (geno > SIZE_MAX / 16)
+      || ((used > 0) && (slot > SIZE_MAX / used)))
+    return SIZE_MAX;
+  return mem_chunk (sizeof (rec_lazy_t))
+    + mem_chunk (nloci * sizeof (double))
+    + mem_chunk (nslots * sizeof (rec_lazy_slot_t))
+    + mem_chunk (geno * sizeof (size_t)) + used * slot;
+}
+
+size_t
+rec_lazy_bytes (const rec_lazy_t * lazy)
+{
+  return rec_lazy_size (lazy->geno, lazy->len, lazy->nslots, lazy->used);
+}
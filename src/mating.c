@@ -33,29 +33,50 @@
 #include <errno.h>
 #include <assert.h>
 #include <math.h>
+#include "stats.h"
+
+void
+rmtable_fill (double ** table, const double * freq, size_t geno)
+{
+  /* fill TABLE, of GENO rows, with the random mating table for FREQ */
+  STATS_BEGIN (STATS_STAGE_MTABLE);
+  double denom = 0.0F;
+  for (int i = 0; i < geno; i++)
+    for (int j = 0; j < geno; j++)
+      {
+	table[i][j] = freq[i] * freq[j];
+	denom += table[i][j];
+      }
+  assert (isgreater (denom, 0.0));
+  for (int i = 0; i < geno; i++)
+    for (int j = 0; j < geno; j++)
+      table[i][j] /= denom;
+  STATS_END (STATS_STAGE_MTABLE);
+}
 
 double **
 rmtable (double * freq, size_t geno)
 {
   /* random mating table */
+  STATS_ADD (STATS_ALLOCS, geno + 1);
   double ** table = malloc (geno * sizeof (double *));
   if (table == NULL)
     error (0, ENOMEM, "Null pointer\n");
-  double denom = 0.0F;
   for (int i = 0; i < geno; i++)
     {
-      table[i] = calloc (geno, sizeof (double));
+      table[i] = malloc (geno * sizeof (double));
       if (table[i] == NULL)
 	error (0, ENOMEM, "Null pointer\n");
-      for (int j = 0; j < geno; j++)
-	{
-	  table[i][j] = freq[i] * freq[j];
-	  denom += table[i][j];
-	}
     }
-  assert (isgreater (denom, 0.0));
-  for (int i = 0; i < geno; i++)
-    for (int j = 0; j < geno; j++)
-      table[i][j] /= denom;
+  rmtable_fill (table, freq, geno);
   return table;
 }
+
+double **
+rmtable_ws (const double * freq, haploid_ws_t * ws)
+{
+  /* the random mating table for FREQ, in WS: valid until the next call
+     with WS */
+  rmtable_fill (ws->mtable, freq, ws->geno);
+  return ws->mtable;
+}
@@ -0,0 +1,175 @@
+/*
+
+  mem.c: predicting and accounting for the memory a model needs
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* The number of entries in a recombination table depends only on the
+   number of loci and on which recombination fractions are 0 or 1, so
+   it can be counted exactly without building the table: see
+   mem_nnz ().  From it, mem_estimate () gives the bytes each
+   representation of the table would take, and mem_usage () the bytes
+   that a constructed model actually holds, by the same rules, so the
+   two agree exactly unless the table needed more than one chunk (see
+   rec.c).
+
+   Byte counts are of heap chunks, not of the sizes asked for: each
+   allocation costs a size word and is rounded up to 16 bytes, with 32
+   at least, as the GNU C Library does on 64-bit hosts.  Counts that do
+   not fit in a size_t are SIZE_MAX. */
+
+#include <stdint.h>
+#include <string.h>
+#include "haploid.h"
+#include "sparse.h"
+
+/* possible source parents at a locus: a set of J and K */
+#define MEM_J 1
+#define MEM_K 2
+#define MEM_JK 3
+
+static size_t
+mem_add (size_t a, size_t b)
+{
+  size_t c;
+  return __builtin_add_overflow (a, b, &c) ? SIZE_MAX : c;
+}
+
+static size_t
+mem_mul (size_t a, size_t b)
+{
+  size_t c;
+  return __builtin_mul_overflow (a, b, &c) ? SIZE_MAX : c;
+}
+
+size_t
+mem_chunk (size_t n)
+{
+  /* bytes of heap taken by a request for N bytes */
+  if (n > SIZE_MAX - 2 * sizeof (size_t) - 15)
+    return SIZE_MAX;
+  size_t chunk = (n + sizeof (size_t) + 15) & ~(size_t) 15;
+  return (chunk < 32) ? 32 : chunk;
+}
+
+static size_t
+mem_mtable_bytes (size_t geno)
+{
+  /* an array of GENO rows of GENO doubles */
+  size_t row = mem_chunk (mem_mul (geno, sizeof (double)));
+  return mem_add (mem_chunk (mem_mul (geno, sizeof (double *))),
+		  mem_mul (geno, row));
+}
+
+size_t
+mem_nnz (size_t nloci, const double * r)
+{
+  /* every offspring has as many possible parents (J, K), so count them
+     for one.  At each locus both parents carry the offspring's allele,
+     or only J, or only K; the pair is possible if a source parent can
+     be chosen at each locus that carries the allele there, switching
+     parents across interval t only if R[t] > 0 and keeping the same
+     parent only if R[t] < 1.  N[s] counts the pairs of genomes up to
+     the current locus for which the set of possible sources there is
+     S */
+  if ((nloci < 1) || (nloci >= 8 * sizeof (size_t)))
+    return 0;
+  size_t n[4] = { 0, 1, 1, 1 };
+  for (size_t t = 1; t < nloci; t++)
+    {
+      size_t next[4] = { 0, 0, 0, 0 };
+      for (int s = MEM_J; s <= MEM_JK; s++)
+	{
+	  int reach;
+	  if (r[t - 1] == 0.0)
+	    reach = s;
+	  else if (isgreaterequal (r[t - 1], 1.0))
+	    reach = ((s & MEM_J) ? MEM_K : 0) | ((s & MEM_K) ? MEM_J : 0);
+	  else
+	    reach = MEM_JK;
+	  /* both parents carry the allele, then only J, then only K */
+	  next[reach] = mem_add (next[reach], n[s]);
+	  if (reach & MEM_J)
+	    next[MEM_J] = mem_add (next[MEM_J], n[s]);
+	  if (reach & MEM_K)
+	    next[MEM_K] = mem_add (next[MEM_K], n[s]);
+	}
+      for (int s = MEM_J; s <= MEM_JK; s++)
+	n[s] = next[s];
+    }
+  size_t pairs = mem_add (mem_add (n[MEM_J], n[MEM_K]), n[MEM_JK]);
+  return mem_mul (pairs, (size_t) 1 << nloci);
+}
+
+int
+mem_estimate (size_t nloci, const double * r, haploid_mem_t * mem)
+{
+  /* predict the size of every representation of the model with NLOCI
+     loci and recombination fractions R */
+  if ((nloci < 1) || (nloci >= 8 * sizeof (size_t)))
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  size_t geno = (size_t) 1 << nloci;
+  mem->nnz = mem_nnz (nloci, r);
+  mem->list = rec_table_bytes (geno, mem->nnz);
+  mem->fixed = (nloci <= REC_FIXED_MAXLOCI) ? rec_fixed_bytes () : 0;
+  mem->mtable = mem_mtable_bytes (geno);
+  /* at most one value for each entry, and for 16-bit codes */
+  size_t nvals = (mem->nnz < 1 << 16) ? mem->nnz : 1 << 16;
+  mem->packed = (nloci <= REC_PACKED_MAXLOCI)
+    ? rec_packed_size (geno, mem->nnz, nvals) : 0;
+  /* with every slice cached */
+  mem->lazy = rec_lazy_size (geno, mem->nnz / geno, geno, geno);
+  return 0;
+}
+
+void
+mem_usage (const haploid_data_t * data, haploid_mem_t * mem)
+{
+  /* the bytes held by the tables of DATA; a table that is NULL holds
+     none */
+  size_t geno = data->geno;
+  memset (mem, 0, sizeof (haploid_mem_t));
+  if (data->rec_table != NULL)
+    {
+      for (size_t k = 0; k < geno; k++)
+	for (rtable_t * elt = data->rec_table[k]; elt != NULL;
+	     elt = elt->next)
+	  mem->nnz++;
+      mem->list = rec_table_heap (data->rec_table, geno);
+    }
+  if (data->rec_fixed != NULL)
+    mem->fixed = rec_fixed_bytes ();
+  if (data->mtable != NULL)
+    mem->mtable = mem_mtable_bytes (geno);
+  if (data->rec_packed != NULL)
+    mem->packed = rec_packed_bytes (data->rec_packed);
+  if (data->rec_lazy != NULL)
+    mem->lazy = rec_lazy_bytes (data->rec_lazy);
+}
@@ -0,0 +1,183 @@
+/*
+
+  model.c: models shared between threads, and their populations
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A haploid_data_t holds the recombination table, which never changes
+   once it is built, together with a mating table, which changes every
+   generation; so it cannot be shared.  A model holds only what does
+   not change: the recombination map and the tables made from it,
+   which are read and never written, so any number of threads may use
+   one model at once without locking.  It is freed when the last
+   reference to it is dropped.
+
+   A population holds what changes: its frequencies and a workspace
+   (see ws.c) for its mating table, with a reference to its model.  A
+   population belongs to one thread at a time.  */
+
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include "haploid.h"
+#include "stats.h"
+
+struct haploid_model_t
+{
+  atomic_size_t refs;
+  double * r;			/* NLOCI - 1 recombination fractions */
+  haploid_data_t data;		/* the tables, with no mating table */
+};
+
+haploid_model_t *
+model_new (size_t nloci, const double * r)
+{
+  /* a model of NLOCI loci with recombination map R, with one
+     reference, held by the caller; returns NULL (with errno set to
+     EINVAL) if a mating table for NLOCI loci could not be indexed */
+  if ((nloci < 1) || (nloci >= 4 * sizeof (size_t)))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  size_t geno = (size_t) 1 << nloci;
+  haploid_model_t * model = calloc (1, sizeof (haploid_model_t));
+  if (model == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  model->r = calloc (nloci, sizeof (double));
+  if (model->r == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  atomic_init (&model->refs, 1);
+  memcpy (model->r, r, (nloci - 1) * sizeof (double));
+  model->data.geno = geno;
+  model->data.nloci = nloci;
+  model->data.rec_table = rec_gen_table (model->r, geno);
+  /* rec_mating () has kernels of its own for small genomes */
+  if (nloci > REC_FIXED_MAXLOCI)
+    model->data.rec_packed = rec_packed_table (model->data.rec_table, geno);
+  return model;
+}
+
+haploid_model_t *
+model_ref (haploid_model_t * model)
+{
+  /* another reference to MODEL */
+  atomic_fetch_add_explicit (&model->refs, 1, memory_order_relaxed);
+  return model;
+}
+
+void
+model_unref (haploid_model_t * model)
+{
+  /* drop a reference to MODEL, freeing it if it was the last */
+  if (model == NULL)
+    return;
+  if (atomic_fetch_sub_explicit (&model->refs, 1, memory_order_acq_rel) > 1)
+    return;
+  rec_packed_free (model->data.rec_packed);
+  rec_free_table (model->data.rec_table, model->data.geno);
+  free (model->r);
+  free (model);
+}
+
+size_t
+model_refs (const haploid_model_t * model)
+{
+  return atomic_load_explicit (&model->refs, memory_order_relaxed);
+}
+
+haploid_data_t
+model_data (const haploid_model_t * model)
+{
+  /* the tables of MODEL, to pass to rec_mating () with a mating table
+     of the caller's; they must not be changed or freed */
+  return model->data;
+}
+
+const double *
+model_map (const haploid_model_t * model)
+{
+  return model->r;
+}
+
+haploid_pop_t *
+pop_new (haploid_model_t * model, const double * freqs)
+{
+  /* a population of MODEL with genotype frequencies FREQS, or uniform
+     frequencies if FREQS is NULL; it holds a reference to MODEL */
+  haploid_pop_t * pop = malloc (sizeof (haploid_pop_t));
+  if (pop == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  pop->model = model_ref (model);
+  pop->data = model->data;
+  pop->ws = ws_new (model->data.nloci);
+  size_t geno = model->data.geno;
+  pop->freqs = malloc (geno * sizeof (double));
+  if (pop->freqs == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  for (size_t i = 0; i < geno; i++)
+    pop->freqs[i] = (freqs == NULL) ? 1.0 / geno : freqs[i];
+  return pop;
+}
+
+void
+pop_free (haploid_pop_t * pop)
+{
+  if (pop == NULL)
+    return;
+  ws_free (pop->ws);
+  free (pop->freqs);
+  model_unref (pop->model);
+  free (pop);
+}
+
+double
+pop_select (haploid_pop_t * pop, const double * W)
+{
+  /* selection by fitnesses W; returns the mean fitness */
+  STATS_BEGIN (STATS_STAGE_SELECT);
+  size_t geno = pop->data.geno;
+  double wbar = 0.0;
+  for (size_t i = 0; i < geno; i++)
+    wbar += pop->freqs[i] * W[i];
+  assert (isgreater (wbar, 0.0));
+  for (size_t i = 0; i < geno; i++)
+    pop->freqs[i] *= W[i] / wbar;
+  STATS_END (STATS_STAGE_SELECT);
+  return wbar;
+}
+
+double
+pop_generation (haploid_pop_t * pop, const double * W)
+{
+  /* a generation of selection by fitnesses W (none if W is NULL),
+     random mating and recombination; returns the mean fitness */
+  double wbar = (W != NULL) ? pop_select (pop, W) : 1.0;
+  pop->data.mtable = rmtable_ws (pop->freqs, pop->ws);
+  rec_mating (pop->freqs, &pop->data);
+  return wbar;
+}
@@ -0,0 +1,260 @@
+/*
+
+  packed.c: recombination tables with a dictionary of values
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A recombination table has few distinct values: each is a sum of
+   products of r[t] and 1 - r[t], and there are far fewer such sums
+   than entries (122 for the 46656 entries of six loci with one r).  A
+   packed table keeps each distinct value once, in a dictionary, and
+   each entry as a code into it with its matrix position
+   (row * GENO + col), both as narrow as the table allows: 8-bit codes
+   for up to 256 values, otherwise 16-bit, and 16-bit positions for up
+   to 8 loci, otherwise 32-bit.  That is 3 to 6 bytes an entry, against
+   10 for a flattened table (see fixed.c) and 32 for a linked one.
+   Entries keep the order of the linked lists, so rec_mating () gives
+   the same result to the bit. */
+
+#include <stdint.h>
+#include <string.h>
+#include "haploid.h"
+#include "sparse.h"
+
+/* most values for 8-bit and for 16-bit codes, and most loci for 16-bit
+   positions */
+#define REC_PACKED_CODE8 (1 << 8)
+#define REC_PACKED_CODE16 (1 << 16)
+#define REC_PACKED_POS16 8
+
+typedef void (* rec_packed_kernel_t) (double *, const double *,
+				      const rec_packed_t *);
+typedef void (* rec_packed_rows_t) (double *, double * const *,
+				    const rec_packed_t *);
+
+struct rec_packed_t
+{
+  size_t nloci;
+  size_t nvals;			/* distinct values */
+  double * dict;		/* the values, ascending */
+  size_t * start;		/* GENO + 1 offsets into the entries */
+  void * pos;			/* uint16_t or uint32_t row * GENO + col */
+  void * code;			/* uint8_t or uint16_t index into DICT */
+  rec_packed_kernel_t kernel;	/* for a mating table in one block */
+  rec_packed_rows_t rows;	/* for one given by its rows */
+};
+
+/* a kernel reads the mating table M, of type M_T, at position P with
+   the expression AT */
+#define REC_PACKED_LOOP(NAME, POS_T, CODE_T, M_T, AT)			\
+  static void								\
+  NAME (double * freqs, M_T m, const rec_packed_t * packed)		\
+  {									\
+    const size_t nloci = packed->nloci;					\
+    const size_t geno = (size_t) 1 << nloci;				\
+    const size_t * start = packed->start;				\
+    const POS_T * pos = packed->pos;					\
+    const CODE_T * code = packed->code;					\
+    const double * dict = packed->dict;					\
+    for (size_t k = 0; k < geno; k++)					\
+      {									\
+	double tot = 0.0;						\
+	for (size_t e = start[k]; e < start[k + 1]; e++)		\
+	  {								\
+	    size_t p = pos[e];						\
+	    tot += dict[code[e]] * AT;					\
+	  }								\
+	freqs[k] = tot;							\
+      }									\
+  }
+
+#define REC_PACKED_KERNEL(NAME, POS_T, CODE_T)				\
+  REC_PACKED_LOOP (NAME, POS_T, CODE_T, const double *, m[p])		\
+  REC_PACKED_LOOP (NAME##_rows, POS_T, CODE_T, double * const *,	\
+		   m[p >> nloci][p & (geno - 1)])
+
+REC_PACKED_KERNEL(rec_packed_16_8, uint16_t, uint8_t)
+REC_PACKED_KERNEL(rec_packed_16_16, uint16_t, uint16_t)
+REC_PACKED_KERNEL(rec_packed_32_8, uint32_t, uint8_t)
+REC_PACKED_KERNEL(rec_packed_32_16, uint32_t, uint16_t)
+
+static int
+rec_packed_cmp (const void * a, const void * b)
+{
+  double x = * (const double *) a;
+  double y = * (const double *) b;
+  return (x > y) - (x < y);
+}
+
+rec_packed_t *
+rec_packed_table (rtable_t ** rtable, size_t geno)
+{
+  /* pack the recombination table RTABLE for GENO genotypes; returns
+     NULL (with errno set to EINVAL) if the genome is too large or the
+     table has too many distinct values */
+  size_t nloci = (size_t) log2 (geno);
+  if ((nloci < 1) || (nloci > REC_PACKED_MAXLOCI) || ((1 << nloci) != geno))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+
+  /* sort the values to find the distinct ones */
+  size_t nnz = 0;
+  for (size_t k = 0; k < geno; k++)
+    for (rtable_t * elt = rtable[k]; elt != NULL; elt = elt->next)
+      nnz += (elt->val != 0.0);
+  double * vals = malloc (nnz * sizeof (double));
+  if (vals == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  size_t e = 0;
+  for (size_t k = 0; k < geno; k++)
+    for (rtable_t * elt = rtable[k]; elt != NULL; elt = elt->next)
+      if (elt->val != 0.0)
+	vals[e++] = elt->val;
+  qsort (vals, nnz, sizeof (double), rec_packed_cmp);
+  size_t nvals = 0;
+  for (e = 0; e < nnz; e++)
+    if ((nvals == 0) || (vals[e] != vals[nvals - 1]))
+      vals[nvals++] = vals[e];
+  if (nvals > REC_PACKED_CODE16)
+    {
+      free (vals);
+      errno = EINVAL;
+      return NULL;
+    }
+
+  rec_packed_t * packed = malloc (sizeof (rec_packed_t));
+  if (packed == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  _Bool pos16 = (nloci <= REC_PACKED_POS16);
+  _Bool code8 = (nvals <= REC_PACKED_CODE8);
+  packed->nloci = nloci;
+  packed->nvals = nvals;
+  packed->dict = realloc (vals, nvals * sizeof (double));
+  packed->start = malloc ((geno + 1) * sizeof (size_t));
+  packed->pos = malloc (nnz * (pos16 ? sizeof (uint16_t) : sizeof (uint32_t)));
+  packed->code = malloc (nnz * (code8 ? sizeof (uint8_t) : sizeof (uint16_t)));
+  if ((packed->dict == NULL) || (packed->start == NULL)
+      || (packed->pos == NULL) || (packed->code == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  packed->kernel = pos16
+    ? (code8 ? rec_packed_16_8 : rec_packed_16_16)
+    : (code8 ? rec_packed_32_8 : rec_packed_32_16);
+  packed->rows = pos16
+    ? (code8 ? rec_packed_16_8_rows : rec_packed_16_16_rows)
+    : (code8 ? rec_packed_32_8_rows : rec_packed_32_16_rows);
+
+  e = 0;
+  for (size_t k = 0; k < geno; k++)
+    {
+      packed->start[k] = e;
+      for (rtable_t * elt = rtable[k]; elt != NULL; elt = elt->next)
+	if (elt->val != 0.0)
+	  {
+	    uint32_t pos = elt->indices[0] * geno + elt->indices[1];
+	    double * found = bsearch (&elt->val, packed->dict, nvals,
+				      sizeof (double), rec_packed_cmp);
+	    size_t code = found - packed->dict;
+	    if (pos16)
+	      ((uint16_t *) packed->pos)[e] = pos;
+	    else
+	      ((uint32_t *) packed->pos)[e] = pos;
+	    if (code8)
+	      ((uint8_t *) packed->code)[e] = code;
+	    else
+	      ((uint16_t *) packed->code)[e] = code;
+	    e++;
+	  }
+    }
+  packed->start[geno] = e;
+  return packed;
+}
+
+void
+rec_packed_free (rec_packed_t * packed)
+{
+  if (packed == NULL)
+    return;
+  free (packed->dict);
+  free (packed->start);
+  free (packed->pos);
+  free (packed->code);
+  free (packed);
+}
+
+size_t
+rec_packed_values (const rec_packed_t * packed)
+{
+  return packed->nvals;
+}
+
+_Bool
+rec_packed_mating (double * freqs, haploid_data_t * data)
+{
+  /* run the kernel if DATA carries a packed table that matches its
+     number of loci; return false if the caller should fall back to
+     another table */
+  rec_packed_t * packed = data->rec_packed;
+  if ((packed == NULL) || (packed->nloci != data->nloci))
+    return false;
+  /* a mating table in one block (from rmtable_ws ()) is read as one
+     array; any other, such as one from rmtable (), through its rows */
+  size_t geno = data->geno;
+  double ** mtable = data->mtable;
+  _Bool flat = true;
+  for (size_t i = 1; flat && (i < geno); i++)
+    flat = (mtable[i] == mtable[0] + i * geno);
+  if (flat)
+    packed->kernel (freqs, mtable[0], packed);
+  else
+    packed->rows (freqs, mtable, packed);
+  return true;
+}
+
+size_t
+rec_packed_size (size_t geno, size_t nnz, size_t nvals)
+{
+  /* heap taken by a packed table of NNZ entries with NVALS distinct
+     values (see mem.c) */
+  size_t nloci = (size_t) log2 (geno);
+  size_t pos = (nloci <= REC_PACKED_POS16) ? 2 : 4;
+  size_t code = (nvals <= REC_PACKED_CODE8) ? 1 : 2;
+  if (nnz > SIZE_MAX / 8)
+    return SIZE_MAX;
+  return mem_chunk (sizeof (rec_packed_t))
+    + mem_chunk (nvals * sizeof (double))
+    + mem_chunk ((geno + 1) * sizeof (size_t))
+    + mem_chunk (nnz * pos) + mem_chunk (nnz * code);
+}
+
+size_t
+rec_packed_bytes (const rec_packed_t * packed)
+{
+  size_t geno = (size_t) 1 << packed->nloci;
+  return rec_packed_size (geno, packed->start[geno], packed->nvals);
+}
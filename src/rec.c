@@ -30,84 +30,31 @@
 /* declarations */
 #include <stdio.h>
 #include "sparse.h"
+#include "stats.h"
 #include <float.h>
 #include <assert.h>
 #include <stdint.h>
-
-#define PSWITCH(x) pholder = parent;		\
-  parent = other;				\
-  other = pholder;
+#include <string.h>
 
 double
 rec_iterate (uint j, uint k, uint target, double * r, size_t nloci)
 {
-  /* degenerate condition (to stop recursion); recursion *should* stop
-     when we reach the end of the while loop */
-  if (nloci == 1) return 1.0;
-
-  /* find the first locus where the parents are different from each
-     other or the target */
-  /* this is roach bait: check for bugs here first */
-  uint parent, other;
-  if (bits_isset (j, 0) == bits_isset (target, 0))
-    {
-      parent = j;
-      other = k;
-    }
-  else
+  /* probability that parents J and K produce TARGET given that the
+     first locus comes from J: walk along the loci carrying the
+     probability of having matched TARGET so far with the current
+     locus copied from J (from_j) or from K (from_k); interval t - 1
+     switches chromosomes with probability R[t - 1] */
+  double from_j = (bits_isset (j, 0) == bits_isset (target, 0)) ? 1.0 : 0.0;
+  double from_k = 0.0;
+  for (size_t t = 1; t < nloci; t++)
     {
-      parent = k;
-      other = j;
+      double stay = 1.0 - r[t - 1];
+      double next_j = from_j * stay + from_k * r[t - 1];
+      double next_k = from_k * stay + from_j * r[t - 1];
+      from_j = (bits_isset (j, t) == bits_isset (target, t)) ? next_j : 0.0;
+      from_k = (bits_isset (k, t) == bits_isset (target, t)) ? next_k : 0.0;
     }
-  double total = 1.0F;
-  do
-    {
-      /* go by pairs of loci */
-      uint pmask = 3;
-      uint tbits = target & pmask;
-      uint pbits = parent & pmask;
-      uint obits = other & pmask;
-      /* how many bits do we need to change from the parents to make
-	 the offspring? */
-      int diff = bits_hamming (tbits, pbits) + bits_hamming (tbits, obits);
-      uint pholder;		/* placeholder for switching parents */
-      /* non-recombinant case */
-      if ((diff == 2) && ((pbits == tbits)))
-	total *= 1.0 - *r;
-      /* recombinant case: */
-      else if (diff == 2)
-	{
-	  total *= *r;
-	  /* switch parents */
-	  PSWITCH(void);
-	}
-      else if ((diff == 1) && (bits_hamming (tbits, pbits) == 1))
-	{
-	  /* if the difference arises from a difference from the
-	     parent, then we should switch to the other parental
-	     chromosome */
-	  total *= *r;
-	  /* switch parents */
-	  PSWITCH(void);
-	}
-      else if ((diff == 1)
-	       && (bits_isset (tbits, 1) != bits_isset (obits, 1)))
-	/* then we're in a non-recombinant junction */
-	total *= 1.0 - *r;
-      else if (diff == 1)	/* branching point */
-	{
-	  /* recursion step */
-	  total *= (*r * rec_iterate (other >> 1, parent >> 1, target >> 1,
-				      r+1, nloci - 1)
-		    + (1 - *r) * rec_iterate (parent >> 1, other >> 1, target >> 1,
-					      r+1, nloci - 1));
-	  break;
-	}
-      parent >>= 1; other >>= 1; target >>= 1; nloci--; 
-    } while (nloci > 1);
-
-   /* add up the expressions: */
-  return total;
+  return from_j + from_k;
 }
 
 double
@@ -126,79 +73,252 @@ rec_total (uint j, uint k, uint target, double * r, size_t nloci)
   else if ((bits_hamming (j, k) == 1) && ((j == target) || (k == target)))
     return 0.5;
   
-  double result = rec_iterate (j, k, target, r, nloci); 
-  if ((j & 1) == (k & 1))
-    result += rec_iterate (k, j, target, r, nloci); 
- 
-  return result / 2.0;
+  /* either parental chromosome may supply the first locus */
+  return (rec_iterate (j, k, target, r, nloci)
+	  + rec_iterate (k, j, target, r, nloci)) / 2.0;
 }
 
-void
-rtable_new (rtable_t * rtable, double val, uint i, uint j)
+/* A table's elements are carved out of large chunks of an arena
+   instead of being allocated one by one: each element and its two
+   indices are one rec_node_t, handed out by bumping a count.  The
+   first chunk holds as many elements as mem_nnz () predicts, so a
+   table usually takes two allocations in all: the list heads, with
+   the arena after them, and one chunk.  Should the prediction fall
+   short, further chunks of REC_CHUNK elements are added. */
+
+#define REC_CHUNK 4096
+
+typedef struct rec_chunk_t rec_chunk_t;
+struct rec_chunk_t
 {
-  /* if the incoming rtable is NULL, then we need to create a fresh
-     rtable object */
-  if (rtable == NULL)
-    rtable = sparse_new_elt (NULL, val, NULL);
-  /* otherwise we need to create a new one and link it in to the old
-     one, then advance it by one */
-  rtable->val = val;
-  rtable->indices[0] = i;
-  rtable->indices[1] = j;
-  /* set up the next link in the chain */
-  int * indices = calloc (2, sizeof (int));
-  if (indices == NULL)
-    /* if you don't have enough space for two integers, we might as
-       well give up: */
+  rec_chunk_t * next;		/* the chunk filled before this one */
+  size_t len;			/* elements in this chunk */
+  size_t used;
+  rec_node_t nodes[];
+};
+
+typedef struct rec_arena_t rec_arena_t;
+struct rec_arena_t
+{
+  rec_chunk_t * chunk;		/* the chunk being filled */
+  rec_fixed_t fixed;		/* the map, for rec_mating () */
+};
+
+static rec_arena_t *
+rec_table_arena (rtable_t ** rtable, size_t geno)
+{
+  /* the arena follows the GENO list heads */
+  return (rec_arena_t *) (rtable + geno);
+}
+
+static void
+rec_arena_grow (rec_arena_t * arena, size_t len)
+{
+  rec_chunk_t * chunk = malloc (sizeof (rec_chunk_t)
+				+ len * sizeof (rec_node_t));
+  if (chunk == NULL)
     error (0, ENOMEM, "Null pointer\n");
-  rtable_t * new = sparse_new_elt (indices, 0, NULL);
-  rtable->next = new;
+  STATS_ADD (STATS_ALLOCS, 1);
+  chunk->next = arena->chunk;
+  chunk->len = len;
+  chunk->used = 0;
+  arena->chunk = chunk;
+}
+
+static rtable_t **
+rec_table_append (rec_arena_t * arena, rtable_t ** endptr, double val,
+		  uint i, uint j)
+{
+  /* link a new element with value VAL at (I, J) to ENDPTR, the end of
+     a list, and return the new end */
+  if (arena->chunk->used == arena->chunk->len)
+    rec_arena_grow (arena, REC_CHUNK);
+  rec_node_t * node = arena->chunk->nodes + arena->chunk->used++;
+  node->indices[0] = i;
+  node->indices[1] = j;
+  node->elt.indices = node->indices;
+  node->elt.val = val;
+  node->elt.next = NULL;
+  *endptr = &node->elt;
+  return &node->elt.next;
 }
 
 rtable_t **
 rec_gen_table (double * r, size_t geno)
 {
-  /* first create rtable: an array of sparse matrices of length GENO */
-  sparse_elt_t ** rtable = malloc (geno * sizeof (sparse_elt_t *));
+  STATS_BEGIN (STATS_STAGE_TABLE);
+  /* first create rtable: an array of sparse matrices of length GENO,
+     with the arena for their elements after it */
+  rtable_t ** rtable = malloc (geno * sizeof (rtable_t *)
+			       + sizeof (rec_arena_t));
   if (rtable == NULL)
     error (0, ENOMEM, "Null pointer\n");
+  STATS_ADD (STATS_ALLOCS, 1);
+  size_t nloci = (size_t) log2 (geno);
+  rec_arena_t * arena = rec_table_arena (rtable, geno);
+  arena->chunk = NULL;
+  rec_arena_grow (arena, mem_nnz (nloci, r));
+  /* small genomes keep the map for the kernels of fixed.c */
+  rec_fixed_init (&arena->fixed, r, nloci);
 
   /* iterate over offspring entries, using endptr to keep track of
-     position in the kth entry of rec_table, which is an array of
+     the end of the kth entry of rec_table, which is an array of
      GENO  */
-  size_t nloci = (size_t) log2 (geno);
   for (uint target = 0; target< geno; target++)
     {   
-      rtable[target] = sparse_new_elt (NULL, 0.0, NULL);
-      sparse_elt_t * endptr = rtable[target];
+      rtable[target] = NULL;
+      rtable_t ** endptr = rtable + target;
       for (uint k = 0; k < geno; k++)
 	{
 	  for (uint j = 0; j < geno; j++)
 	    {
-	      double total;
-	      /* does the transpose already exist? */
-	      if ((j == k) && (k == target))
-		{
-		  rtable_new (endptr, 1.0, k, j);
-		  endptr = endptr->next;
-		}
-	      else if (isgreater(total = sparse_get_val (rtable[target], j, k), 0.0))
-		{
-		  rtable_new (endptr, total, k, j);
-		  endptr = endptr->next;
-		}
-	      else if (isgreater(total = rec_total (k, j, target, r, nloci), 0.0))
-		{
-		  rtable_new (endptr, total, k, j);
-		  endptr = endptr->next;
-		}
-	      else continue;
+	      /* rec_total () is symmetric in the parents and takes
+		 O(nloci), less than looking the transpose up in the
+		 list */
+	      double total = rec_total (k, j, target, r, nloci);
+	      if (!isgreater (total, 0.0))
+		continue;
+	      endptr = rec_table_append (arena, endptr, total, k, j);
+	      STATS_ADD (STATS_TABLE_NNZ, 1);
 	    }
 	}      /* for k < geno */
     } /* for target < geno */
+  STATS_END (STATS_STAGE_TABLE);
   return rtable;
 }
 
+const rec_fixed_t *
+rec_table_fixed (rtable_t ** rtable, size_t geno)
+{
+  /* the map kept by rec_gen_table (), or NULL if the genome is too
+     large for the kernels */
+  rec_fixed_t * fixed = &rec_table_arena (rtable, geno)->fixed;
+  return (fixed->nloci > 0) ? fixed : NULL;
+}
+
+void
+rec_free_table (rtable_t ** rtable, size_t geno)
+{
+  /* release RTABLE and every element in it */
+  if (rtable == NULL)
+    return;
+  rec_chunk_t * chunk = rec_table_arena (rtable, geno)->chunk;
+  while (chunk != NULL)
+    {
+      rec_chunk_t * next = chunk->next;
+      free (chunk);
+      chunk = next;
+    }
+  free (rtable);
+}
+
+static void
+rec_validate_note (rec_check_t * check, int kind, double err, uint target,
+		   uint k, uint j)
+{
+  /* count a violation, keeping the largest */
+  check->nbad++;
+  if ((check->kind == REC_VALID) || isgreater (err, check->err))
+    {
+      check->kind = kind;
+      check->err = err;
+      check->target = target;
+      check->k = k;
+      check->j = j;
+    }
+}
+
+int
+rec_validate (rtable_t ** rtable, size_t geno, double tol, rec_check_t * check)
+{
+  /* check that the offspring of each parent pair in RTABLE sum to one
+     and that no value is negative, within TOL, and that each
+     offspring's table is symmetric, in time proportional to the
+     entries: each offspring's entries are scattered into a GENO x GENO
+     scratch matrix, checked against their transposes and cleared
+     again.  Every pair has an offspring, so there are at least
+     GENO^2 entries.  Store the worst violation in CHECK and return its
+     kind */
+  double * sums = calloc (geno * geno, sizeof (double));
+  double * slice = calloc (geno * geno, sizeof (double));
+  if ((sums == NULL) || (slice == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  memset (check, 0, sizeof (rec_check_t));
+  check->kind = REC_VALID;
+  for (uint target = 0; target < geno; target++)
+    {
+      for (rtable_t * elt = rtable[target]; elt != NULL; elt = elt->next)
+	{
+	  uint k = elt->indices[0];
+	  uint j = elt->indices[1];
+	  check->nnz++;
+	  if ((k >= geno) || (j >= geno) || (slice[k * geno + j] != 0.0))
+	    {
+	      /* the entries scattered so far are still cleared below */
+	      rec_validate_note (check, REC_BAD_INDEX, INFINITY, target,
+				 k, j);
+	      continue;
+	    }
+	  slice[k * geno + j] = elt->val;
+	  sums[k * geno + j] += elt->val;
+	  if (isless (elt->val, -tol))
+	    rec_validate_note (check, REC_BAD_NEGATIVE, -elt->val, target,
+			       k, j);
+	}
+      for (rtable_t * elt = rtable[target]; elt != NULL; elt = elt->next)
+	{
+	  uint k = elt->indices[0];
+	  uint j = elt->indices[1];
+	  if ((k >= geno) || (j >= geno))
+	    continue;
+	  /* each asymmetric pair once: from the lower K if both are
+	     present */
+	  double diff = fabs (slice[k * geno + j] - slice[j * geno + k]);
+	  if ((k < j) || (slice[j * geno + k] == 0.0))
+	    if (isgreater (diff, tol))
+	      rec_validate_note (check, REC_BAD_SYMMETRY, diff, target, k, j);
+	}
+      for (rtable_t * elt = rtable[target]; elt != NULL; elt = elt->next)
+	if ((elt->indices[0] < geno) && (elt->indices[1] < geno))
+	  slice[elt->indices[0] * geno + elt->indices[1]] = 0.0;
+    }
+  for (uint k = 0; k < geno; k++)
+    for (uint j = 0; j < geno; j++)
+      {
+	double err = fabs (sums[k * geno + j] - 1.0);
+	if (isgreater (err, tol))
+	  rec_validate_note (check, REC_BAD_SUM, err, 0, k, j);
+      }
+  free (sums);
+  free (slice);
+  return check->kind;
+}
+
+size_t
+rec_table_bytes (size_t geno, size_t nnz)
+{
+  /* heap taken by a table of NNZ elements in one chunk (see mem.c) */
+  if ((nnz > (SIZE_MAX - sizeof (rec_chunk_t)) / sizeof (rec_node_t))
+      || (geno > SIZE_MAX / (2 * sizeof (rtable_t *))))
+    return SIZE_MAX;
+  size_t heads = mem_chunk (geno * sizeof (rtable_t *) + sizeof (rec_arena_t));
+  size_t nodes = mem_chunk (sizeof (rec_chunk_t) + nnz * sizeof (rec_node_t));
+  return (nodes > SIZE_MAX - heads) ? SIZE_MAX : heads + nodes;
+}
+
+size_t
+rec_table_heap (rtable_t ** rtable, size_t geno)
+{
+  /* heap held by RTABLE, chunk by chunk */
+  size_t bytes = mem_chunk (geno * sizeof (rtable_t *)
+			    + sizeof (rec_arena_t));
+  for (rec_chunk_t * chunk = rec_table_arena (rtable, geno)->chunk;
+       chunk != NULL; chunk = chunk->next)
+    bytes += mem_chunk (sizeof (rec_chunk_t)
+			+ chunk->len * sizeof (rec_node_t));
+  return bytes;
+}
+
 void
 rec_mating (double * freqs, haploid_data_t * data)
 {
@@ -208,8 +328,18 @@ rec_mating (double * freqs, haploid_data_t * data)
   /* find the frequencies of offspring from recombination table RTABLE
      and mating table MTABLE */
 
-  /* FREQS[k] is the total of the Hadamard product of MTABLE and
-     RTABLE[k] */
-  for (int k = 0; k < geno; k++)
-    freqs[k] = sparse_mat_tot (geno, mtable, rtable[k]);
+  STATS_BEGIN (STATS_STAGE_RECOMB);
+  STATS_ADD (STATS_GENERATIONS, 1);
+  /* small genomes have their own kernels */
+  if (rec_fixed_mating (freqs, data) || rec_packed_mating (freqs, data))
+    ;
+  else if (rtable != NULL)
+    /* FREQS[k] is the total of the Hadamard product of MTABLE and
+       RTABLE[k] */
+    for (int k = 0; k < geno; k++)
+      freqs[k] = sparse_mat_tot (geno, mtable, rtable[k]);
+  else
+    for (int k = 0; k < geno; k++)
+      freqs[k] = rec_lazy_offspring (data->rec_lazy, mtable, k);
+  STATS_END (STATS_STAGE_RECOMB);
 }
@@ -0,0 +1,333 @@
+/*
+
+  rng.c: counter-based random number streams
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Random numbers come from Philox4x32-10 (Salmon et al. 2011,
+   Parallel random numbers: as easy as 1, 2, 3), a keyed bijection of a
+   128-bit counter.  The key is derived from the seed and the thread;
+   the counter holds the trial and the run in its upper two words and
+   the block number in the lower two.  Any (seed, run, trial, thread)
+   therefore names a stream of 2^66 words that is independent of every
+   other, can be started without generating what comes before, and
+   gives the same numbers wherever it is run. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "haploid.h"
+
+#define PHILOX_M0 UINT32_C(0xD2511F53)
+#define PHILOX_M1 UINT32_C(0xCD9E8D57)
+#define PHILOX_W0 UINT32_C(0x9E3779B9)
+#define PHILOX_W1 UINT32_C(0xBB67AE85)
+#define PHILOX_ROUNDS 10
+
+/* uniform variates generated per batch in rng_fill_uniform () */
+#define RNG_CHUNK 256
+
+/* below this mean rng_binomial () uses inversion */
+#define BINOMIAL_INV_MEAN 10.0
+
+void
+rng_philox (const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4])
+{
+  /* the Philox4x32-10 block function */
+  uint32_t x0 = ctr[0], x1 = ctr[1], x2 = ctr[2], x3 = ctr[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int i = 0; i < PHILOX_ROUNDS; i++)
+    {
+      uint64_t p0 = (uint64_t) PHILOX_M0 * x0;
+      uint64_t p1 = (uint64_t) PHILOX_M1 * x2;
+      x0 = (uint32_t) (p1 >> 32) ^ x1 ^ k0;
+      x1 = (uint32_t) p1;
+      x2 = (uint32_t) (p0 >> 32) ^ x3 ^ k1;
+      x3 = (uint32_t) p0;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+  out[0] = x0;
+  out[1] = x1;
+  out[2] = x2;
+  out[3] = x3;
+}
+
+static uint64_t
+rng_splitmix (uint64_t x)
+{
+  /* a 64-bit finalizer for turning seeds into keys */
+  x += UINT64_C(0x9E3779B97F4A7C15);
+  x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+  x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+  return x ^ (x >> 31);
+}
+
+void
+rng_init (haploid_rng_t * rng, uint64_t seed, uint32_t run, uint32_t trial,
+	  uint32_t thread)
+{
+  /* start the stream named by (SEED, RUN, TRIAL, THREAD) */
+  uint64_t key = rng_splitmix (rng_splitmix (seed) + thread);
+  rng->seed = seed;
+  rng->run = run;
+  rng->trial = trial;
+  rng->thread = thread;
+  rng->key[0] = (uint32_t) key;
+  rng->key[1] = (uint32_t) (key >> 32);
+  rng->ctr[0] = 0;
+  rng->ctr[1] = 0;
+  rng->ctr[2] = trial;
+  rng->ctr[3] = run;
+  /* the buffer is empty */
+  rng->used = 4;
+}
+
+uint64_t
+rng_seed (void)
+{
+  /* a seed for rng_init (): HAPLOID_SEED from the environment if it is
+     set, so a run can be repeated, otherwise fresh entropy */
+  uint64_t seed;
+  const char * env = getenv ("HAPLOID_SEED");
+  if (env != NULL)
+    return strtoull (env, NULL, 0);
+  FILE * urandom = fopen ("/dev/urandom", "rb");
+  if (urandom != NULL)
+    {
+      size_t got = fread (&seed, sizeof (seed), 1, urandom);
+      fclose (urandom);
+      if (got == 1)
+	return seed;
+    }
+  return rng_splitmix ((uint64_t) time (NULL) ^ (uint64_t) clock ());
+}
+
+static inline void
+rng_next_block (haploid_rng_t * rng, uint32_t out[4])
+{
+  /* the next four words, advancing the 64-bit block number */
+  rng_philox (rng->ctr, rng->key, out);
+  if (++rng->ctr[0] == 0)
+    rng->ctr[1]++;
+}
+
+uint32_t
+rng_u32 (haploid_rng_t * rng)
+{
+  /* 32 random bits */
+  if (rng->used == 4)
+    {
+      rng_next_block (rng, rng->buf);
+      rng->used = 0;
+    }
+  return rng->buf[rng->used++];
+}
+
+double
+rng_uniform (haploid_rng_t * rng)
+{
+  /* a uniform variate on [0, 1) with 53 random bits */
+  uint32_t a = rng_u32 (rng) >> 5;
+  uint32_t b = rng_u32 (rng) >> 6;
+  return (a * 67108864.0 + b) * 0x1.0p-53;
+}
+
+void
+rng_fill_u32 (haploid_rng_t * rng, uint32_t * out, size_t n)
+{
+  /* N words, the same as N calls to rng_u32 (); whole blocks are
+     written straight into OUT */
+  size_t i = 0;
+  while ((i < n) && (rng->used < 4))
+    out[i++] = rng->buf[rng->used++];
+  for (; i + 4 <= n; i += 4)
+    rng_next_block (rng, out + i);
+  while (i < n)
+    out[i++] = rng_u32 (rng);
+}
+
+void
+rng_fill_uniform (haploid_rng_t * rng, double * out, size_t n)
+{
+  /* N uniform variates, the same as N calls to rng_uniform (); the
+     words are generated RNG_CHUNK variates at a time */
+  uint32_t words[2 * RNG_CHUNK];
+  while (n > 0)
+    {
+      size_t len = (n < RNG_CHUNK) ? n : RNG_CHUNK;
+      rng_fill_u32 (rng, words, 2 * len);
+      for (size_t i = 0; i < len; i++)
+	out[i] = ((words[2 * i] >> 5) * 67108864.0 + (words[2 * i + 1] >> 6))
+	  * 0x1.0p-53;
+      out += len;
+      n -= len;
+    }
+}
+
+static double
+rng_fc (unsigned long k)
+{
+  /* the correction term of Stirling's approximation to log (k!) */
+  static const double table[] =
+    {
+      0.08106146679532726, 0.04134069595540929, 0.02767792568499834,
+      0.02079067210376509, 0.01664469118982119, 0.01387612882307075,
+      0.01189670994589177, 0.01041126526197209, 0.009255462182712733,
+      0.008330563433362871
+    };
+  if (k < 10)
+    return table[k];
+  double kp1 = k + 1.0;
+  double kp1sq = kp1 * kp1;
+  return (1.0 / 12.0 - (1.0 / 360.0 - 1.0 / 1260.0 / kp1sq) / kp1sq) / kp1;
+}
+
+static unsigned long
+rng_binomial_inv (haploid_rng_t * rng, unsigned long n, double p)
+{
+  /* inversion: walk up the probability function from zero */
+  double q = 1.0 - p;
+  double s = p / q;
+  double a = (n + 1) * s;
+  double f = pow (q, n);
+  double u = rng_uniform (rng);
+  unsigned long k = 0;
+  while (u > f)
+    {
+      u -= f;
+      k++;
+      if (k > n)
+	/* rounding has used up the whole distribution: start again */
+	return rng_binomial_inv (rng, n, p);
+      f *= a / k - s;
+    }
+  return k;
+}
+
+static unsigned long
+rng_binomial_btrd (haploid_rng_t * rng, unsigned long n, double p)
+{
+  /* Hormann (1993), The generation of binomial random variates,
+     J. Statist. Comput. Simul. 46: 101-110; needs n * p >= 10 and
+     p <= 0.5 */
+  double q = 1.0 - p;
+  double m = floor ((n + 1) * p);
+  double r = p / q;
+  double nr = (n + 1) * r;
+  double npq = n * p * q;
+  double spq = sqrt (npq);
+  double b = 1.15 + 2.53 * spq;
+  double a = -0.0873 + 0.0248 * b + 0.01 * p;
+  double c = n * p + 0.5;
+  double alpha = (2.83 + 5.1 / b) * spq;
+  double vr = 0.92 - 4.2 / b;
+  double urvr = 0.86 * vr;
+
+  for (;;)
+    {
+      double u, v = rng_uniform (rng);
+      if (v <= urvr)
+	{
+	  /* the triangular centre: accept at once */
+	  u = v / vr - 0.43;
+	  return (unsigned long) floor ((2.0 * a / (0.5 - fabs (u)) + b) * u
+					+ c);
+	}
+      if (v >= vr)
+	u = rng_uniform (rng) - 0.5;
+      else
+	{
+	  u = v / vr - 0.93;
+	  u = copysign (0.5, u) - u;
+	  v = rng_uniform (rng) * vr;
+	}
+
+      double us = 0.5 - fabs (u);
+      double k = floor ((2.0 * a / us + b) * u + c);
+      if ((k < 0.0) || (k > n))
+	continue;
+      v = v * alpha / (a / (us * us) + b);
+      double km = fabs (k - m);
+      if (km <= 15.0)
+	{
+	  /* evaluate the ratio of probabilities recursively */
+	  double f = 1.0;
+	  if (m < k)
+	    for (double i = m + 1.0; i <= k; i++)
+	      f *= nr / i - r;
+	  else if (m > k)
+	    for (double i = k + 1.0; i <= m; i++)
+	      v *= nr / i - r;
+	  if (v <= f)
+	    return (unsigned long) k;
+	  continue;
+	}
+      /* squeeze with the normal approximation */
+      v = log (v);
+      double rho = (km / npq) * (((km / 3.0 + 0.625) * km + 1.0 / 6.0) / npq
+				 + 0.5);
+      double t = -km * km / (2.0 * npq);
+      if (v < t - rho)
+	return (unsigned long) k;
+      if (v > t + rho)
+	continue;
+      /* final acceptance test with Stirling's formula */
+      double nm = n - m + 1.0;
+      double h = (m + 0.5) * log ((m + 1.0) / (r * nm))
+	+ rng_fc (m) + rng_fc (n - m);
+      double nk = n - k + 1.0;
+      if (v <= h + (n + 1.0) * log (nm / nk)
+	  + (k + 0.5) * log (nk * r / (k + 1.0))
+	  - rng_fc (k) - rng_fc (n - k))
+	return (unsigned long) k;
+    }
+}
+
+unsigned long
+rng_binomial (haploid_rng_t * rng, unsigned long n, double p)
+{
+  /* a binomial (N, P) random variate */
+  if ((n == 0) || (p <= 0.0))
+    return 0;
+  if (p >= 1.0)
+    return n;
+  if (p > 0.5)
+    return n - rng_binomial (rng, n, 1.0 - p);
+  if (n * p < BINOMIAL_INV_MEAN)
+    return rng_binomial_inv (rng, n, p);
+  return rng_binomial_btrd (rng, n, p);
+}
+
+void
+rng_fill_binomial (haploid_rng_t * rng, unsigned long n, double * p,
+		   size_t len, unsigned long * out)
+{
+  /* independent binomial (N, P[i]) variates in OUT[i] */
+  for (size_t i = 0; i < len; i++)
+    out[i] = rng_binomial (rng, n, p[i]);
+}
@@ -0,0 +1,140 @@
+/*
+
+  sim.c: simulations that run for a budget and resume
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A simulation written as a loop runs until it stops; it cannot be
+   put aside and taken up again.  A simulation object keeps everything
+   the loop would, so sim_run_for () can run it for a number of
+   generations or a length of time and return, saying whether it
+   converged, fixed or ran out of budget; the next call carries on from
+   the same generation.  A scheduler can so run any number of
+   simulations on one thread in turns, and give up on one that will not
+   converge.  Every call runs at least one generation, so repeated
+   calls always make progress. */
+
+#include <string.h>
+#include <time.h>
+#include "haploid.h"
+
+haploid_sim_t *
+sim_new (haploid_model_t * model, const double * freqs, const double * W,
+	 double tol)
+{
+  /* a simulation of a population of MODEL starting from FREQS (uniform
+     if NULL) under fitnesses W (none if NULL), which converges when
+     successive generations are closer than TOL */
+  haploid_sim_t * sim = malloc (sizeof (haploid_sim_t));
+  if (sim == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  sim->pop = pop_new (model, freqs);
+  sim->prev = malloc (sim->pop->data.geno * sizeof (double));
+  if (sim->prev == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  sim->W = W;
+  sim->tol = tol;
+  /* near fixation a generation changes the frequencies by about s
+     times the distance from it, for selection coefficient s, so
+     generations come within TOL of each other before fixation does
+     unless s is large; with this, fixation is seen first whenever s is
+     above sqrt (TOL) */
+  sim->fixed = sqrt (tol);
+  sim->mating = NULL;
+  sim->observe = NULL;
+  sim->arg = NULL;
+  sim->gens = 0;
+  sim->status = SIM_BUDGET;
+  return sim;
+}
+
+void
+sim_free (haploid_sim_t * sim)
+{
+  if (sim == NULL)
+    return;
+  pop_free (sim->pop);
+  free (sim->prev);
+  free (sim);
+}
+
+static int
+sim_generation (haploid_sim_t * sim)
+{
+  /* one generation; returns the status after it */
+  haploid_pop_t * pop = sim->pop;
+  size_t geno = pop->data.geno;
+  memcpy (sim->prev, pop->freqs, geno * sizeof (double));
+  if (sim->mating == NULL)
+    pop_generation (pop, sim->W);
+  else
+    {
+      if (sim->W != NULL)
+	pop_select (pop, sim->W);
+      sim->mating (pop->ws->mtable, pop->freqs, geno, sim->arg);
+      pop->data.mtable = pop->ws->mtable;
+      rec_mating (pop->freqs, &pop->data);
+    }
+  sim->gens++;
+  if (sim->observe != NULL)
+    sim->observe (sim, sim->arg);
+
+  for (size_t i = 0; i < geno; i++)
+    if (isgreaterequal (pop->freqs[i], 1.0 - sim->fixed))
+      return SIM_FIXED;
+  if (!sim_stop_ck (sim->prev, pop->freqs, geno, sim->tol))
+    return SIM_CONVERGED;
+  return SIM_BUDGET;
+}
+
+static double
+sim_clock (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int
+sim_run_for (haploid_sim_t * sim, uint64_t max_gens, double max_seconds)
+{
+  /* run SIM until it converges or fixes, for at most MAX_GENS more
+     generations and MAX_SECONDS (either unlimited if 0); returns
+     SIM_CONVERGED, SIM_FIXED or, if it may be resumed, SIM_BUDGET */
+  if (sim->status != SIM_BUDGET)
+    return sim->status;
+  double deadline = (max_seconds > 0.0) ? sim_clock () + max_seconds : 0.0;
+  for (uint64_t n = 0; (max_gens == 0) || (n < max_gens); n++)
+    {
+      sim->status = sim_generation (sim);
+      if (sim->status != SIM_BUDGET)
+	break;
+      if ((deadline > 0.0) && !isless (sim_clock (), deadline))
+	break;
+    }
+  return sim->status;
+}
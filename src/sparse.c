@@ -52,6 +52,7 @@
 */
 #include "haploid.h"
 #include "sparse.h"
+#include "stats.h"
 
 
 sparse_elt_t *
@@ -59,6 +60,7 @@ sparse_new_elt (int * indices, double value, sparse_elt_t * next)
 {
   /* return a pointer to a new sparse-matrix element */
   sparse_elt_t * new_elt;
+  STATS_ADD (STATS_ALLOCS, (indices == NULL) ? 2 : 1);
   if (( new_elt = malloc (sizeof (sparse_elt_t))) == NULL )
     /* null pointer bad bad!! exit! die! */
     error (0, ENOMEM, "Null pointer\n");
@@ -144,6 +146,7 @@ sparse_mat_tot (size_t len, double * dense[len], sparse_elt_t * sparse)
      sparse */
   double result = 0.0;
   sparse_elt_t * endptr = sparse;
+  STATS_ADD (STATS_MAT_TOT, 1);
   /* iterate along SPARSE, placing a sum in result */
   for (; endptr != NULL; endptr = endptr->next)
     {
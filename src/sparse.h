@@ -43,4 +43,65 @@ sparse_get_val (sparse_elt_t * list, int row, int col);
 double
 sparse_mat_tot (size_t len, double * dense[len], sparse_elt_t * sparse);
 
+/* an element of a recombination table with its indices, as rec.c
+   and lazy.c allocate them */
+typedef struct rec_node_t rec_node_t;
+struct rec_node_t
+{
+  sparse_elt_t elt;
+  int indices[2];
+};
+
+/* the recombination map of a genome small enough for the kernels of
+   fixed.c, as rec_gen_table () keeps it after the table */
+struct rec_fixed_t
+{
+  size_t nloci;			/* 0 if there is no kernel */
+  double r[REC_FIXED_MAXLOCI - 1];
+};
+
+/* rec.c */
+double
+rec_total (uint j, uint k, uint target, double * r, size_t nloci);
+
+const rec_fixed_t *
+rec_table_fixed (rtable_t ** rtable, size_t geno);
+
+size_t
+rec_table_bytes (size_t geno, size_t nnz);
+
+size_t
+rec_table_heap (rtable_t ** rtable, size_t geno);
+
+/* fixed.c */
+_Bool
+rec_fixed_mating (double * freqs, haploid_data_t * data);
+
+void
+rec_fixed_init (rec_fixed_t * fixed, const double * r, size_t nloci);
+
+size_t
+rec_fixed_bytes (void);
+
+/* lazy.c */
+size_t
+rec_lazy_size (size_t geno, size_t len, size_t nslots, size_t used);
+
+size_t
+rec_lazy_bytes (const rec_lazy_t * lazy);
+
+/* packed.c */
+_Bool
+rec_packed_mating (double * freqs, haploid_data_t * data);
+
+size_t
+rec_packed_size (size_t geno, size_t nnz, size_t nvals);
+
+size_t
+rec_packed_bytes (const rec_packed_t * packed);
+
+/* mem.c */
+size_t
+mem_chunk (size_t n);
+
 #endif	/*  SPARSE_H */
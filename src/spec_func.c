@@ -29,13 +29,14 @@
   along with haploid.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <math.h>
+#include "stats.h"
 double
-gen_mean (double * props, double * vals, int len)
+gen_mean (double * props, double * vals, size_t geno)
 {
   /* calculate a generalized mean given an array of values and
      probabilities */     
   double mean = 0.0;
-  for (int i = 0; i < len; i++)
+  for (size_t i = 0; i < geno; i++)
     mean += props[i] * vals[i];
   /* return the mean */
   return mean;
@@ -45,12 +46,11 @@ static inline double
 euclid_dist (double * array1, double * array2, int len)
 {
   /* a simple Euclidean distance function */
-  double diffarray[len];
   double eudiff = 0.0;
   for (int i = 0; i < len; i++)
     {
-      diffarray[i] = array1[i] - array2[i];
-      eudiff += diffarray[i] * diffarray[i];
+      double diff = array1[i] - array2[i];
+      eudiff += diff * diff;
     }
   return sqrt (eudiff);
 }
@@ -68,10 +68,10 @@ sim_stop_ck (double * p1, double * p2, int len, long double tol)
 
   */
 
-  if (euclid_dist (p1, p2, len) < tol)
-    return 0;
-  else
-    /* return 1 to signal that distance is still large */
-    return 1;
+  STATS_BEGIN (STATS_STAGE_CONVERGE);
+  int still = !(euclid_dist (p1, p2, len) < tol);
+  STATS_END (STATS_STAGE_CONVERGE);
+  /* return 1 to signal that distance is still large */
+  return still;
 }
 
@@ -0,0 +1,379 @@
+/*
+
+  spop.c: sparse genotype-frequency populations
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A sparse population holds only the haplotypes that are present, as
+   (64-bit haplotype, frequency) pairs in an array sorted by haplotype.
+   Haplotypes use the same convention as everywhere else in the
+   library (bit i is locus i), but there is no array of length 2^nloci
+   anywhere, so a population founded from a few haplotypes can have up
+   to 64 loci.
+
+   Every operation that creates haplotypes (recombination, mutation)
+   appends contributions to the end of the array and then calls
+   spop_compact (), which sorts them and adds up the duplicates.
+   spop_add () only appends, so that founding a population from K
+   haplotypes costs one sort rather than K; the other functions
+   compact what it left first (spop_settle ()). */
+
+#include <string.h>
+#include <assert.h>
+#include "haploid.h"
+#include "stats.h"
+
+static void
+spop_reserve (spop_t * pop, size_t len)
+{
+  /* make room for LEN entries */
+  if (len <= pop->cap)
+    return;
+  size_t cap = (pop->cap > 0) ? pop->cap : 16;
+  while (cap < len)
+    cap <<= 1;
+  spop_elt_t * elts = realloc (pop->elts, cap * sizeof (spop_elt_t));
+  if (elts == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  pop->elts = elts;
+  pop->cap = cap;
+}
+
+static inline void
+spop_push (spop_t * pop, uint64_t id, double freq)
+{
+  if (pop->n == pop->cap)
+    spop_reserve (pop, pop->n + 1);
+  pop->elts[pop->n].id = id;
+  pop->elts[pop->n].freq = freq;
+  pop->n++;
+}
+
+static int
+spop_cmp (const void * a, const void * b)
+{
+  uint64_t x = ((const spop_elt_t *) a)->id;
+  uint64_t y = ((const spop_elt_t *) b)->id;
+  return (x > y) - (x < y);
+}
+
+static void
+spop_compact (spop_t * pop)
+{
+  /* sort the entries by haplotype and add up duplicates */
+  if (pop->n == 0)
+    return;
+  qsort (pop->elts, pop->n, sizeof (spop_elt_t), spop_cmp);
+  size_t last = 0;
+  for (size_t i = 1; i < pop->n; i++)
+    {
+      if (pop->elts[i].id == pop->elts[last].id)
+	pop->elts[last].freq += pop->elts[i].freq;
+      else
+	pop->elts[++last] = pop->elts[i];
+    }
+  pop->n = last + 1;
+  pop->sorted = true;
+}
+
+static inline void
+spop_settle (spop_t * pop)
+{
+  /* sort what spop_add () appended */
+  if (!pop->sorted)
+    spop_compact (pop);
+}
+
+spop_t *
+spop_new (size_t nloci)
+{
+  /* an empty population of haplotypes with NLOCI loci */
+  if (nloci > SPOP_MAXLOCI)
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  spop_t * pop = malloc (sizeof (spop_t));
+  if (pop == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  pop->nloci = nloci;
+  pop->n = 0;
+  pop->cap = 0;
+  pop->elts = NULL;
+  pop->sorted = true;
+  return pop;
+}
+
+void
+spop_free (spop_t * pop)
+{
+  if (pop == NULL)
+    return;
+  free (pop->elts);
+  free (pop);
+}
+
+void
+spop_add (spop_t * pop, uint64_t id, double freq)
+{
+  /* add FREQ to the frequency of haplotype ID; haplotypes added in
+     increasing order keep POP sorted */
+  if ((pop->n > 0) && (id <= pop->elts[pop->n - 1].id))
+    pop->sorted = false;
+  spop_push (pop, id, freq);
+}
+
+double
+spop_get (spop_t * pop, uint64_t id)
+{
+  /* the frequency of haplotype ID (binary search) */
+  spop_settle (pop);
+  size_t lo = 0, hi = pop->n;
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (pop->elts[mid].id < id)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  if ((lo < pop->n) && (pop->elts[lo].id == id))
+    return pop->elts[lo].freq;
+  return 0.0;
+}
+
+spop_t *
+spop_from_dense (double * freqs, size_t geno)
+{
+  /* a sparse population holding the non-zero entries of FREQS */
+  spop_t * pop = spop_new ((size_t) log2 (geno));
+  if (pop == NULL)
+    return NULL;
+  for (size_t i = 0; i < geno; i++)
+    if (freqs[i] != 0.0)
+      spop_push (pop, i, freqs[i]);
+  return pop;
+}
+
+void
+spop_to_dense (spop_t * pop, double * freqs, size_t geno)
+{
+  /* scatter POP into the dense array FREQS; haplotypes that do not
+     fit in GENO entries are ignored */
+  spop_settle (pop);
+  for (size_t i = 0; i < geno; i++)
+    freqs[i] = 0.0;
+  for (size_t i = 0; i < pop->n; i++)
+    if (pop->elts[i].id < geno)
+      freqs[pop->elts[i].id] = pop->elts[i].freq;
+}
+
+double
+spop_prune (spop_t * pop, double threshold)
+{
+  /* drop every haplotype whose frequency is below THRESHOLD and scale
+     the rest back up to the former total; return the mass dropped */
+  spop_settle (pop);
+  double total = 0.0, dropped = 0.0;
+  size_t last = 0;
+  for (size_t i = 0; i < pop->n; i++)
+    {
+      double f = pop->elts[i].freq;
+      total += f;
+      if (isless (f, threshold))
+	dropped += f;
+      else
+	pop->elts[last++] = pop->elts[i];
+    }
+  pop->n = last;
+  if (isgreater (dropped, 0.0) && isgreater (total - dropped, 0.0))
+    {
+      double scale = total / (total - dropped);
+      for (size_t i = 0; i < pop->n; i++)
+	pop->elts[i].freq *= scale;
+    }
+  return dropped;
+}
+
+double
+spop_select (spop_t * pop, double (* fitness) (uint64_t id, void * arg),
+	     void * arg)
+{
+  /* selection: multiply each frequency by the fitness of its
+     haplotype and divide by the mean fitness, which is returned */
+  STATS_BEGIN (STATS_STAGE_SELECT);
+  spop_settle (pop);
+  double wbar = 0.0;
+  for (size_t i = 0; i < pop->n; i++)
+    {
+      pop->elts[i].freq *= fitness (pop->elts[i].id, arg);
+      wbar += pop->elts[i].freq;
+    }
+  assert (isgreater (wbar, 0.0));
+  for (size_t i = 0; i < pop->n; i++)
+    pop->elts[i].freq /= wbar;
+  STATS_END (STATS_STAGE_SELECT);
+  return wbar;
+}
+
+double
+spop_mutate (spop_t * pop, double * mu, double threshold)
+{
+  /* mutation at rate MU[i] at locus i, independently across loci:
+     one locus at a time, each haplotype keeps 1 - MU[i] of its
+     frequency and passes MU[i] to the haplotype with locus i flipped;
+     haplotypes below THRESHOLD are pruned after each locus, and the
+     total mass pruned is returned */
+  double dropped = 0.0;
+  spop_settle (pop);
+  for (size_t i = 0; i < pop->nloci; i++)
+    {
+      if (mu[i] == 0.0)
+	continue;
+      uint64_t bit = UINT64_C(1) << i;
+      size_t n = pop->n;
+      spop_reserve (pop, 2 * n);
+      for (size_t k = 0; k < n; k++)
+	{
+	  double f = pop->elts[k].freq;
+	  pop->elts[n + k].id = pop->elts[k].id ^ bit;
+	  pop->elts[n + k].freq = f * mu[i];
+	  pop->elts[k].freq = f * (1.0 - mu[i]);
+	}
+      pop->n = 2 * n;
+      spop_compact (pop);
+      dropped += spop_prune (pop, threshold);
+    }
+  return dropped;
+}
+
+static void
+spop_segregate (spop_t * out, uint64_t child, const int * loci,
+		const double * rho, size_t m, size_t t, _Bool from_a,
+		uint64_t a, double w, double threshold, double * dropped)
+{
+  /* walk the loci where the parents differ (LOCI[t] onward), choosing
+     a parent for each; FROM_A says which parent locus LOCI[t - 1] came
+     from, RHO[t] is the probability of an odd number of crossovers
+     between LOCI[t - 1] and LOCI[t] */
+  if (t == m)
+    {
+      spop_push (out, child, w);
+      return;
+    }
+  if (isless (w, threshold))
+    {
+      /* this branch can only produce negligible offspring */
+      *dropped += w;
+      return;
+    }
+  uint64_t bit = UINT64_C(1) << loci[t];
+  /* the allele of parent A at this locus, and that of parent B */
+  uint64_t abit = a & bit, bbit = (~a) & bit;
+  double stay = 1.0 - rho[t], swap = rho[t];
+  if (stay > 0.0)
+    spop_segregate (out, child | (from_a ? abit : bbit), loci, rho, m,
+		    t + 1, from_a, a, w * stay, threshold, dropped);
+  if (swap > 0.0)
+    spop_segregate (out, child | (from_a ? bbit : abit), loci, rho, m,
+		    t + 1, !from_a, a, w * swap, threshold, dropped);
+}
+
+double
+spop_recombine (spop_t * pop, double * r, double threshold)
+{
+  /* one round of random mating with recombination map R (NLOCI - 1
+     adjacent recombination fractions); each pair of haplotypes only
+     produces the offspring obtained by choosing a parent at each
+     locus where they differ (a segregation mask), so the work per
+     pair is 2^(number of differing loci) rather than anything in the
+     size of the genome.  Offspring contributions below THRESHOLD are
+     not followed further, and haplotypes below THRESHOLD are pruned
+     at the end.  The mass of both is spread back over the haplotypes
+     that are kept, so the total stays the same; what is returned is
+     the mass so approximated: that of the branches not followed plus
+     that pruned. */
+  spop_settle (pop);
+  size_t n = pop->n;
+  size_t nloci = pop->nloci;
+  spop_t * out = spop_new (nloci);
+  double dropped = 0.0;
+  int loci[SPOP_MAXLOCI];
+  double rho[SPOP_MAXLOCI];
+
+  spop_reserve (out, n);
+  for (size_t i = 0; i < n; i++)
+    {
+      uint64_t a = pop->elts[i].id;
+      double fa = pop->elts[i].freq;
+      /* identical parents only produce themselves */
+      spop_push (out, a, fa * fa);
+      for (size_t j = i + 1; j < n; j++)
+	{
+	  uint64_t b = pop->elts[j].id;
+	  /* both orders of the pair */
+	  double w = 2.0 * fa * pop->elts[j].freq;
+	  uint64_t diff = a ^ b;
+	  size_t m = 0;
+	  for (uint64_t d = diff; d != 0; d &= d - 1)
+	    loci[m++] = __builtin_ctzll (d);
+	  /* probability of an odd number of crossovers between
+	     successive differing loci */
+	  rho[0] = 0.5;
+	  for (size_t t = 1; t < m; t++)
+	    {
+	      double p = 1.0;
+	      for (int u = loci[t - 1]; u < loci[t]; u++)
+		p *= 1.0 - 2.0 * r[u];
+	      rho[t] = (1.0 - p) / 2.0;
+	    }
+	  /* loci where the parents agree are inherited as they are;
+	     the first differing locus comes from either parent with
+	     probability one half */
+	  spop_segregate (out, a & ~diff, loci, rho, m, 0, true, a, w,
+			  threshold, &dropped);
+	}
+    }
+  spop_compact (out);
+  /* put back the mass of the branches that were not followed, so
+     that only pruning below changes the total */
+  double total = 0.0;
+  for (size_t i = 0; i < out->n; i++)
+    total += out->elts[i].freq;
+  if (isgreater (dropped, 0.0) && isgreater (total, 0.0))
+    for (size_t i = 0; i < out->n; i++)
+      out->elts[i].freq *= (total + dropped) / total;
+  dropped += spop_prune (out, threshold);
+
+  /* swap the new population into POP */
+  free (pop->elts);
+  pop->elts = out->elts;
+  pop->n = out->n;
+  pop->cap = out->cap;
+  free (out);
+  return dropped;
+}
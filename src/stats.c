@@ -0,0 +1,298 @@
+/*
+
+  stats.c: counters, stage timers and event traces
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* With --enable-stats every thread keeps its own counters and stage
+   times in thread-local storage, so counting costs no more than an
+   addition.  The first time a thread counts anything its totals are
+   put on a list, which stats_get () walks to add up all threads; when
+   a thread exits its totals are folded into those of threads gone.
+
+   A trace, if one is open, gets a Chrome trace event ("ph": "X") for
+   every stage timed, which chrome://tracing and Perfetto can display.
+   Without --enable-stats these functions do nothing, stats_get ()
+   reports zeros and stats_trace_open () fails with ENOSYS. */
+
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "haploid.h"
+#include "stats.h"
+
+static const char * stage_names[STATS_NSTAGES] =
+  {
+    "rec_gen_table", "rmtable", "rec_mating", "selection", "sim_stop_ck",
+    "user"
+  };
+
+#ifdef HAPLOID_STATS
+
+/* a thread's totals and its place on the list */
+struct stats_thread_t
+{
+  haploid_stats_t * stats;
+  uint64_t start[STATS_NSTAGES];	/* when each open stage began */
+  unsigned int tid;
+  stats_thread_t * next;
+};
+
+__thread haploid_stats_t stats_local;
+__thread stats_thread_t * stats_self = NULL;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+/* threads that have counted, and the totals of those that exited */
+static stats_thread_t * stats_threads = NULL;
+static haploid_stats_t stats_retired;
+static unsigned int stats_ntid = 0;
+
+/* the trace */
+static haploid_writer_t * stats_trace = NULL;
+static int stats_trace_fd = -1;
+static _Bool stats_trace_first;
+
+static uint64_t
+stats_now (void)
+{
+  /* nanoseconds */
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+stats_sum (haploid_stats_t * into, const haploid_stats_t * from)
+{
+  for (int c = 0; c < STATS_NCOUNTERS; c++)
+    into->count[c] += __atomic_load_n (from->count + c, __ATOMIC_RELAXED);
+  for (int s = 0; s < STATS_NSTAGES; s++)
+    {
+      into->stage_ns[s] += __atomic_load_n (from->stage_ns + s,
+					    __ATOMIC_RELAXED);
+      into->stage_calls[s] += __atomic_load_n (from->stage_calls + s,
+					       __ATOMIC_RELAXED);
+    }
+}
+
+static void
+stats_exit (void * p)
+{
+  /* a thread is exiting: keep its totals, forget the thread */
+  stats_thread_t * self = p;
+  pthread_mutex_lock (&stats_lock);
+  stats_sum (&stats_retired, self->stats);
+  for (stats_thread_t ** t = &stats_threads; *t != NULL; t = &(*t)->next)
+    if (*t == self)
+      {
+	*t = self->next;
+	break;
+      }
+  pthread_mutex_unlock (&stats_lock);
+  free (self);
+}
+
+static void
+stats_init (void)
+{
+  pthread_key_create (&stats_key, stats_exit);
+}
+
+stats_thread_t *
+stats_register (void)
+{
+  /* this thread's entry on the list */
+  if (stats_self != NULL)
+    return stats_self;
+  pthread_once (&stats_once, stats_init);
+  stats_thread_t * self = calloc (1, sizeof (stats_thread_t));
+  if (self == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  self->stats = &stats_local;
+  pthread_mutex_lock (&stats_lock);
+  self->tid = stats_ntid++;
+  self->next = stats_threads;
+  stats_threads = self;
+  pthread_mutex_unlock (&stats_lock);
+  pthread_setspecific (stats_key, self);
+  return stats_self = self;
+}
+
+static void
+stats_event (int stage, uint64_t start, uint64_t end, unsigned int tid)
+{
+  /* one complete event in the trace, in microseconds */
+  pthread_mutex_lock (&stats_lock);
+  if (stats_trace != NULL)
+    {
+      writer_printf (stats_trace,
+		     "%s\n{\"name\":\"%s\",\"cat\":\"haploid\",\"ph\":\"X\","
+		     "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+		     stats_trace_first ? "" : ",", stage_names[stage],
+		     start / 1e3, (end - start) / 1e3, (int) getpid (), tid);
+      stats_trace_first = false;
+    }
+  pthread_mutex_unlock (&stats_lock);
+}
+
+#endif	/* HAPLOID_STATS */
+
+_Bool
+stats_enabled (void)
+{
+#ifdef HAPLOID_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+stats_begin (int stage)
+{
+  /* start timing STAGE on this thread */
+#ifdef HAPLOID_STATS
+  stats_register ()->start[stage] = stats_now ();
+#endif
+}
+
+void
+stats_end (int stage)
+{
+  /* stop timing STAGE on this thread */
+#ifdef HAPLOID_STATS
+  stats_thread_t * self = stats_register ();
+  uint64_t end = stats_now ();
+  uint64_t * ns = stats_local.stage_ns + stage;
+  uint64_t * calls = stats_local.stage_calls + stage;
+  __atomic_store_n (ns, *ns + (end - self->start[stage]), __ATOMIC_RELAXED);
+  __atomic_store_n (calls, *calls + 1, __ATOMIC_RELAXED);
+  if (__atomic_load_n (&stats_trace, __ATOMIC_RELAXED) != NULL)
+    stats_event (stage, self->start[stage], end, self->tid);
+#endif
+}
+
+void
+stats_get (haploid_stats_t * stats)
+{
+  /* the totals of all threads */
+  memset (stats, 0, sizeof (haploid_stats_t));
+#ifdef HAPLOID_STATS
+  pthread_mutex_lock (&stats_lock);
+  stats_sum (stats, &stats_retired);
+  for (stats_thread_t * t = stats_threads; t != NULL; t = t->next)
+    stats_sum (stats, t->stats);
+  pthread_mutex_unlock (&stats_lock);
+#endif
+}
+
+void
+stats_get_thread (haploid_stats_t * stats)
+{
+  /* the totals of the calling thread */
+  memset (stats, 0, sizeof (haploid_stats_t));
+#ifdef HAPLOID_STATS
+  stats_sum (stats, &stats_local);
+#endif
+}
+
+void
+stats_reset (void)
+{
+  /* zero the totals; call it while no other thread is counting */
+#ifdef HAPLOID_STATS
+  pthread_mutex_lock (&stats_lock);
+  memset (&stats_retired, 0, sizeof (haploid_stats_t));
+  for (stats_thread_t * t = stats_threads; t != NULL; t = t->next)
+    memset (t->stats, 0, sizeof (haploid_stats_t));
+  pthread_mutex_unlock (&stats_lock);
+#endif
+}
+
+const char *
+stats_stage_name (int stage)
+{
+  return ((stage >= 0) && (stage < STATS_NSTAGES)) ? stage_names[stage]
+    : NULL;
+}
+
+int
+stats_trace_open (const char * path)
+{
+  /* start writing a trace of every stage timed to PATH */
+#ifdef HAPLOID_STATS
+  int fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    return -1;
+  haploid_writer_t * w = writer_new (fd, 0);
+  writer_str (w, "{\"traceEvents\":[");
+  pthread_mutex_lock (&stats_lock);
+  if (stats_trace != NULL)
+    {
+      pthread_mutex_unlock (&stats_lock);
+      writer_free (w);
+      close (fd);
+      errno = EBUSY;
+      return -1;
+    }
+  stats_trace_first = true;
+  stats_trace_fd = fd;
+  __atomic_store_n (&stats_trace, w, __ATOMIC_RELAXED);
+  pthread_mutex_unlock (&stats_lock);
+  return 0;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+int
+stats_trace_close (void)
+{
+  /* finish the trace */
+#ifdef HAPLOID_STATS
+  pthread_mutex_lock (&stats_lock);
+  haploid_writer_t * w = stats_trace;
+  int fd = stats_trace_fd;
+  __atomic_store_n (&stats_trace, NULL, __ATOMIC_RELAXED);
+  stats_trace_fd = -1;
+  pthread_mutex_unlock (&stats_lock);
+  if (w == NULL)
+    return 0;
+  writer_str (w, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  int status = writer_free (w);
+  if (close (fd) != 0)
+    status = -1;
+  return status;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,76 @@
+#ifndef STATS_H
+#define STATS_H
+
+/*
+
+  stats.h: internal instrumentation hooks for haploid
+
+  Copyright 2026 Joel J. Adamson 
+  
+  $Id$$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* The library counts and times its work through these macros.  Unless
+   haploid is configured with --enable-stats they expand to nothing, so
+   an ordinary build pays nothing for them. */
+
+#include "haploid.h"
+
+#ifdef HAPLOID_STATS
+
+/* each thread's running totals, and whether they are on the list that
+   stats_get () reads */
+typedef struct stats_thread_t stats_thread_t;
+extern __thread haploid_stats_t stats_local;
+extern __thread stats_thread_t * stats_self;
+
+stats_thread_t *
+stats_register (void);
+
+static inline void
+stats_add (int counter, uint64_t n)
+{
+  /* only this thread writes its totals; the relaxed accesses let
+     stats_get () read them from another thread */
+  if (__builtin_expect (stats_self == NULL, 0))
+    stats_register ();
+  uint64_t * c = stats_local.count + counter;
+  __atomic_store_n (c, __atomic_load_n (c, __ATOMIC_RELAXED) + n,
+		    __ATOMIC_RELAXED);
+}
+
+# define STATS_ADD(counter, n) stats_add ((counter), (n))
+# define STATS_BEGIN(stage) stats_begin (stage)
+# define STATS_END(stage) stats_end (stage)
+
+#else  /* !HAPLOID_STATS */
+
+# define STATS_ADD(counter, n) ((void) 0)
+# define STATS_BEGIN(stage) ((void) 0)
+# define STATS_END(stage) ((void) 0)
+
+#endif	/* HAPLOID_STATS */
+
+#endif	/* STATS_H */
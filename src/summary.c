@@ -0,0 +1,113 @@
+/*
+
+  summary.c: per-generation population summaries
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Logging a generation usually means calling genotype_to_allele (),
+   ld_sub_geno (), gen_mean () and sim_stop_ck () one after the other,
+   and each of those is a pass over the genotype frequencies.
+   haploid_summarize () gets all of those numbers from a single pass. */
+#include "haploid.h"
+
+/* genotypes are visited in blocks of this many (a power of two), as
+   in genotype_to_allele () */
+#define SUMMARY_BLOCK 256
+
+void
+haploid_summarize (double * freqs, double * prev, double * W,
+		   size_t geno, haploid_summary_t * summary)
+{
+  /* fill SUMMARY from the genotype frequencies FREQS; PREV (the
+     previous generation) and W (fitnesses) may be NULL, in which case
+     the distance and the mean fitness are NAN */
+  size_t nloci = (size_t) log2 (geno);
+  size_t block = (geno < SUMMARY_BLOCK) ? geno : SUMMARY_BLOCK;
+  size_t lowloci = (size_t) log2 (block);
+  double * alleles = summary->alleles;
+  double * ld = summary->ld;
+  uint * masks = summary->ld_masks;
+  size_t nld = summary->nld;
+  double acc[SUMMARY_BLOCK];
+  double total = 0.0;
+  double wbar = 0.0;
+  double dist = 0.0;
+
+  for (size_t i = 0; i < block; i++)
+    acc[i] = 0.0;
+  for (int j = 0; j < nloci; j++)
+    alleles[j] = 0.0;
+  /* LD terms first collect their sub-genotype frequencies */
+  for (size_t q = 0; q < nld; q++)
+    ld[q] = 0.0;
+
+  for (size_t base = 0; base < geno; base += block)
+    {
+      double tot = 0.0;
+      for (size_t i = 0; i < block; i++)
+	{
+	  size_t k = base + i;
+	  double f = freqs[k];
+	  acc[i] += f;
+	  tot += f;
+	  if (W != NULL)
+	    wbar += f * W[k];
+	  if (prev != NULL)
+	    {
+	      double diff = f - prev[k];
+	      dist += diff * diff;
+	    }
+	  for (size_t q = 0; q < nld; q++)
+	    if ((k & masks[q]) == masks[q])
+	      ld[q] += f;
+	}
+      total += tot;
+      for (int j = lowloci; j < nloci; j++)
+	if (bits_isset (base, j))
+	  alleles[j] += tot;
+    }
+  for (int j = 0; j < lowloci; j++)
+    for (size_t i = 0; i < block; i++)
+      if (bits_isset (i, j))
+	alleles[j] += acc[i];
+
+  /* now subtract the products of allele frequencies, as in
+     ld_sub_geno () */
+  for (size_t q = 0; q < nld; q++)
+    {
+      double subtrahend = 1.0;
+      for (int j = 0; j < nloci; j++)
+	if (bits_isset (masks[q], j))
+	  subtrahend *= alleles[j];
+      ld[q] -= subtrahend;
+    }
+
+  summary->total = total;
+  summary->drift = total - 1.0;
+  summary->wbar = (W != NULL) ? wbar : NAN;
+  summary->dist = (prev != NULL) ? sqrt (dist) : NAN;
+}
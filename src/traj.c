@@ -0,0 +1,403 @@
+/*
+
+  traj.c: binary trajectory files
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A trajectory file is a header (traj_header_t), the NLOCI - 1
+   recombination fractions, the GENO fitnesses if TRAJ_FITNESS is set,
+   and then one record per generation kept: the generation number and
+   the GENO frequencies, all 64-bit words in the byte order of the
+   machine that wrote it.  Plain records have a fixed size, so a mapped
+   file is an array that needs no parsing.
+
+   With TRAJ_XOR each word of a record is predicted from the same word
+   of the previous two records by extending a straight line through
+   them.  The XOR of the word with its prediction is written as a tag
+   byte followed by only the bytes that are not zero: the high nibble
+   of the tag counts zero bytes at the top and the low nibble zero
+   bytes at the bottom.  Frequencies that change smoothly agree with
+   the prediction in sign, exponent and leading digits, so this is
+   lossless and smaller; a frequency that has stopped changing takes
+   one byte. */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "haploid.h"
+
+#define TRAJ_MAGIC "HAPTRAJ1"
+#define TRAJ_BYTEORDER UINT32_C(0x01020304)
+/* the tag of a word that is zero */
+#define TRAJ_ZERO 0x80
+
+traj_t *
+traj_open (haploid_writer_t * w, const traj_info_t * info)
+{
+  /* start a trajectory on W, writing its header; the header keeps
+     GENO in 32 bits */
+  if ((info->nloci >= 32)
+      || (info->geno != (size_t) 1 << info->nloci)
+      || (info->flags & ~(TRAJ_XOR | TRAJ_FITNESS))
+      || (((info->flags & TRAJ_FITNESS) != 0) != (info->W != NULL)))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  traj_t * t = malloc (sizeof (traj_t));
+  if (t == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  size_t geno = info->geno;
+  t->w = w;
+  t->geno = geno;
+  t->flags = info->flags;
+  t->every = info->every;
+  t->threshold = info->threshold;
+  t->nrec = 0;
+  t->last_gen = 0;
+  t->prev_gen = 0;
+  /* the records before the first are zero */
+  t->last = calloc (geno, sizeof (double));
+  t->prev = calloc (geno, sizeof (double));
+  /* the longest encoded record: a tag and eight bytes per word */
+  t->buf = malloc (9 * (geno + 1));
+  if ((t->last == NULL) || (t->prev == NULL) || (t->buf == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+
+  traj_header_t header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, TRAJ_MAGIC, sizeof (header.magic));
+  header.byteorder = TRAJ_BYTEORDER;
+  header.flags = info->flags;
+  header.nloci = info->nloci;
+  header.geno = geno;
+  header.every = info->every;
+  header.threshold = info->threshold;
+  header.seed = info->seed;
+  writer_bytes (w, &header, sizeof (header));
+  if (info->nloci > 1)
+    writer_bytes (w, info->r, (info->nloci - 1) * sizeof (double));
+  if (info->W != NULL)
+    writer_bytes (w, info->W, geno * sizeof (double));
+  if (w->err != 0)
+    {
+      errno = w->err;
+      traj_close (t);
+      return NULL;
+    }
+  return t;
+}
+
+int
+traj_close (traj_t * t)
+{
+  /* flush and free T; the writer stays open */
+  if (t == NULL)
+    return 0;
+  int status = writer_flush (t->w);
+  free (t->last);
+  free (t->prev);
+  free (t->buf);
+  free (t);
+  return status;
+}
+
+static inline double
+traj_predict (double last, double prev)
+{
+  /* the guess at the next value from the last two: a straight line */
+  return last + (last - prev);
+}
+
+static inline unsigned char *
+traj_encode (unsigned char * dest, uint64_t x)
+{
+  /* one XORed word: the tag, then the bytes between the zero bytes at
+     either end */
+  if (x == 0)
+    {
+      *dest++ = TRAJ_ZERO;
+      return dest;
+    }
+  int lz = __builtin_clzll (x) / 8;
+  int tz = __builtin_ctzll (x) / 8;
+  *dest++ = (lz << 4) | tz;
+  x >>= 8 * tz;
+  for (int i = 8 - lz - tz; i > 0; i--, x >>= 8)
+    *dest++ = (unsigned char) x;
+  return dest;
+}
+
+static int
+traj_write (traj_t * t, uint64_t gen, const double * freqs)
+{
+  /* write one record and remember it */
+  size_t geno = t->geno;
+  if (t->flags & TRAJ_XOR)
+    {
+      unsigned char * dest = t->buf;
+      dest = traj_encode (dest, gen ^ (2 * t->last_gen - t->prev_gen));
+      for (size_t i = 0; i < geno; i++)
+	{
+	  uint64_t now, guess;
+	  double pred = traj_predict (t->last[i], t->prev[i]);
+	  memcpy (&now, freqs + i, sizeof (now));
+	  memcpy (&guess, &pred, sizeof (guess));
+	  dest = traj_encode (dest, now ^ guess);
+	}
+      writer_bytes (t->w, t->buf, dest - t->buf);
+    }
+  else
+    {
+      writer_bytes (t->w, &gen, sizeof (gen));
+      writer_bytes (t->w, freqs, geno * sizeof (double));
+    }
+  double * tmp = t->prev;
+  t->prev = t->last;
+  t->last = tmp;
+  memcpy (t->last, freqs, geno * sizeof (double));
+  t->prev_gen = t->last_gen;
+  t->last_gen = gen;
+  t->nrec++;
+  if (t->w->err != 0)
+    {
+      errno = t->w->err;
+      return -1;
+    }
+  return 1;
+}
+
+int
+traj_record (traj_t * t, uint64_t gen, const double * freqs)
+{
+  /* offer generation GEN: it is written if it is the first, if it is
+     a multiple of EVERY, or if some frequency has moved by more than
+     THRESHOLD since the last record written; with neither EVERY nor
+     THRESHOLD every generation is written.  Return 1 if the record was
+     written, 0 if not and -1 on error */
+  _Bool keep = (t->nrec == 0) || ((t->every == 0) && (t->threshold <= 0.0));
+  if (!keep && (t->every > 0))
+    keep = (gen % t->every == 0);
+  if (!keep && (t->threshold > 0.0))
+    for (size_t i = 0; (i < t->geno) && !keep; i++)
+      keep = isgreater (fabs (freqs[i] - t->last[i]), t->threshold);
+  if (!keep)
+    return 0;
+  return traj_write (t, gen, freqs);
+}
+
+int
+traj_final (traj_t * t, uint64_t gen, const double * freqs)
+{
+  /* write generation GEN unless it is the last record written; for
+     the end of a run, whatever the decimation */
+  if ((t->nrec > 0) && (gen == t->last_gen))
+    return 0;
+  return traj_write (t, gen, freqs);
+}
+
+static const unsigned char *
+traj_decode (const unsigned char * src, const unsigned char * end,
+	     uint64_t * x)
+{
+  /* the inverse of traj_encode (), or NULL at a malformed word */
+  if (src >= end)
+    return NULL;
+  unsigned char tag = *src++;
+  if (tag == TRAJ_ZERO)
+    {
+      *x = 0;
+      return src;
+    }
+  int lz = tag >> 4;
+  int tz = tag & 0xf;
+  int len = 8 - lz - tz;
+  if ((lz + tz >= 8) || (end - src < len))
+    return NULL;
+  uint64_t v = 0;
+  for (int i = 0; i < len; i++)
+    v |= (uint64_t) src[i] << (8 * i);
+  *x = v << (8 * tz);
+  return src + len;
+}
+
+static int
+traj_unpack (traj_map_t * map, const unsigned char * src,
+	     const unsigned char * end)
+{
+  /* decode XORed records into MAP->DECODED */
+  size_t words = map->header->geno + 1;
+  size_t cap = 0;
+  /* the last two records, zero before the first */
+  uint64_t * last = calloc (words, sizeof (uint64_t));
+  uint64_t * prev = calloc (words, sizeof (uint64_t));
+  if ((last == NULL) || (prev == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  map->nrec = 0;
+  map->decoded = NULL;
+  while (src < end)
+    {
+      if (map->nrec == cap)
+	{
+	  cap = (cap == 0) ? 64 : 2 * cap;
+	  map->decoded = realloc (map->decoded, cap * words * sizeof (uint64_t));
+	  if (map->decoded == NULL)
+	    error (0, ENOMEM, "Null pointer\n");
+	}
+      uint64_t * rec = map->decoded + map->nrec * words;
+      for (size_t i = 0; i < words; i++)
+	{
+	  uint64_t x;
+	  src = traj_decode (src, end, &x);
+	  if (src == NULL)
+	    {
+	      free (last);
+	      free (prev);
+	      return -1;
+	    }
+	  uint64_t guess;
+	  if (i == 0)
+	    guess = 2 * last[0] - prev[0];
+	  else
+	    {
+	      double a, b;
+	      memcpy (&a, last + i, sizeof (a));
+	      memcpy (&b, prev + i, sizeof (b));
+	      double pred = traj_predict (a, b);
+	      memcpy (&guess, &pred, sizeof (guess));
+	    }
+	  rec[i] = guess ^ x;
+	}
+      memcpy (prev, last, words * sizeof (uint64_t));
+      memcpy (last, rec, words * sizeof (uint64_t));
+      map->nrec++;
+    }
+  free (last);
+  free (prev);
+  map->records = map->decoded;
+  return 0;
+}
+
+traj_map_t *
+traj_map (const char * path)
+{
+  /* map the trajectory file at PATH; return NULL with errno set if it
+     cannot be read or is not a trajectory written on this kind of
+     machine */
+  int fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat (fd, &st) != 0)
+    {
+      close (fd);
+      return NULL;
+    }
+  size_t size = st.st_size;
+  if (size < sizeof (traj_header_t))
+    {
+      close (fd);
+      errno = EINVAL;
+      return NULL;
+    }
+  void * base = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (base == MAP_FAILED)
+    return NULL;
+
+  traj_map_t * map = malloc (sizeof (traj_map_t));
+  if (map == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  map->base = base;
+  map->size = size;
+  map->decoded = NULL;
+  const traj_header_t * header = map->header = base;
+  if ((memcmp (header->magic, TRAJ_MAGIC, sizeof (header->magic)) != 0)
+      || (header->byteorder != TRAJ_BYTEORDER)
+      || (header->nloci >= 32)
+      || (header->geno != (uint32_t) 1 << header->nloci))
+    goto invalid;
+
+  /* the parameters after the header */
+  const double * params = (const double *) (header + 1);
+  size_t nparams = (header->nloci > 1) ? header->nloci - 1 : 0;
+  map->r = params;
+  map->W = NULL;
+  if (header->flags & TRAJ_FITNESS)
+    {
+      map->W = params + nparams;
+      nparams += header->geno;
+    }
+  size_t offset = sizeof (traj_header_t) + nparams * sizeof (double);
+  if (offset > size)
+    goto invalid;
+
+  const unsigned char * records = (const unsigned char *) base + offset;
+  size_t words = header->geno + 1;
+  if (header->flags & TRAJ_XOR)
+    {
+      if (traj_unpack (map, records, (const unsigned char *) base + size)
+	  != 0)
+	goto invalid;
+    }
+  else
+    {
+      if ((size - offset) % (words * sizeof (uint64_t)) != 0)
+	goto invalid;
+      map->nrec = (size - offset) / (words * sizeof (uint64_t));
+      map->records = (const uint64_t *) records;
+    }
+  return map;
+
+ invalid:
+  traj_unmap (map);
+  errno = EINVAL;
+  return NULL;
+}
+
+void
+traj_unmap (traj_map_t * map)
+{
+  if (map == NULL)
+    return;
+  munmap (map->base, map->size);
+  free (map->decoded);
+  free (map);
+}
+
+const double *
+traj_get (const traj_map_t * map, size_t i, uint64_t * gen)
+{
+  /* the frequencies of record I, and its generation in GEN if that is
+     not NULL */
+  const uint64_t * rec = map->records + i * (map->header->geno + 1);
+  if (gen != NULL)
+    *gen = rec[0];
+  return (const double *) (rec + 1);
+}
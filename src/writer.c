@@ -0,0 +1,260 @@
+/*
+
+  writer.c: buffered output of formatted and binary records
+  Copyright 2026 Joel J. Adamson 
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A writer collects output in a buffer of fixed size and hands it to
+   write (2) when the next record would not fit, so the memory used is
+   the same for ten generations as for ten million.  Frequencies are
+   printed by writer_fixed (), which gives exactly what printf's "%f"
+   conversion would without going through printf: the double is scaled
+   by a power of ten with an exact two-part product, rounded to
+   nearest with ties to even, and the digits of the resulting integer
+   written out directly. */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include "haploid.h"
+
+/* the buffer size when none is given */
+#define WRITER_DEFAULT_SIZE 65536
+/* the longest output of writer_fixed () that avoids snprintf (): sign,
+   sixteen integer digits, the point and WRITER_MAXPREC digits */
+#define WRITER_FIXED_MAX (2 + 16 + WRITER_MAXPREC)
+
+haploid_writer_t *
+writer_new (int fd, size_t size)
+{
+  /* a writer to the file descriptor FD that flushes every SIZE bytes
+     (or WRITER_DEFAULT_SIZE if SIZE is zero) */
+  if (size == 0)
+    size = WRITER_DEFAULT_SIZE;
+  /* writer_fixed () must always fit after a flush */
+  if (size < WRITER_FIXED_MAX)
+    size = WRITER_FIXED_MAX;
+  haploid_writer_t * w = malloc (sizeof (haploid_writer_t));
+  if (w == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  w->buf = malloc (size);
+  if (w->buf == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  w->fd = fd;
+  w->size = size;
+  w->len = 0;
+  w->err = 0;
+  return w;
+}
+
+int
+writer_flush (haploid_writer_t * w)
+{
+  /* write out the buffer; on failure return -1 with errno set, and
+     keep failing until writer_free () */
+  size_t done = 0;
+  while ((done < w->len) && (w->err == 0))
+    {
+      ssize_t n = write (w->fd, w->buf + done, w->len - done);
+      if (n >= 0)
+	done += n;
+      else if (errno != EINTR)
+	w->err = errno;
+    }
+  w->len = 0;
+  if (w->err != 0)
+    {
+      errno = w->err;
+      return -1;
+    }
+  return 0;
+}
+
+int
+writer_free (haploid_writer_t * w)
+{
+  /* flush and free W; the file descriptor stays open */
+  if (w == NULL)
+    return 0;
+  int status = writer_flush (w);
+  free (w->buf);
+  free (w);
+  return status;
+}
+
+static inline char *
+writer_reserve (haploid_writer_t * w, size_t n)
+{
+  /* room for N bytes (N <= size), flushing if need be */
+  if (w->len + n > w->size)
+    writer_flush (w);
+  return w->buf + w->len;
+}
+
+int
+writer_bytes (haploid_writer_t * w, const void * data, size_t n)
+{
+  /* a binary record, or any N bytes */
+  if (n > w->size)
+    {
+      /* too big to buffer: write it straight through */
+      writer_flush (w);
+      const char * p = data;
+      while ((n > 0) && (w->err == 0))
+	{
+	  ssize_t done = write (w->fd, p, n);
+	  if (done >= 0)
+	    {
+	      p += done;
+	      n -= done;
+	    }
+	  else if (errno != EINTR)
+	    w->err = errno;
+	}
+    }
+  else
+    {
+      memcpy (writer_reserve (w, n), data, n);
+      w->len += n;
+    }
+  if (w->err != 0)
+    {
+      errno = w->err;
+      return -1;
+    }
+  return 0;
+}
+
+int
+writer_char (haploid_writer_t * w, char c)
+{
+  *writer_reserve (w, 1) = c;
+  w->len++;
+  return (w->err == 0) ? 0 : -1;
+}
+
+int
+writer_str (haploid_writer_t * w, const char * s)
+{
+  return writer_bytes (w, s, strlen (s));
+}
+
+int
+writer_printf (haploid_writer_t * w, const char * format, ...)
+{
+  /* printf into the buffer, for what writer_fixed () cannot do */
+  va_list ap;
+  va_start (ap, format);
+  int n = vsnprintf (w->buf + w->len, w->size - w->len, format, ap);
+  va_end (ap);
+  if (n < 0)
+    return -1;
+  if (w->len + n < w->size)
+    {
+      w->len += n;
+      return (w->err == 0) ? 0 : -1;
+    }
+  /* it did not fit: format it again, after a flush if that is enough
+     room and in a buffer of its own if not */
+  writer_flush (w);
+  va_start (ap, format);
+  if ((size_t) n < w->size)
+    {
+      vsnprintf (w->buf, w->size, format, ap);
+      w->len = n;
+    }
+  else
+    {
+      char * big = malloc (n + 1);
+      if (big == NULL)
+	error (0, ENOMEM, "Null pointer\n");
+      vsnprintf (big, n + 1, format, ap);
+      writer_bytes (w, big, n);
+      free (big);
+    }
+  va_end (ap);
+  return (w->err == 0) ? 0 : -1;
+}
+
+int
+writer_fixed (haploid_writer_t * w, double x, int width, int prec,
+	      _Bool left)
+{
+  /* X as printf would print it with "%*.*f" (or "%-*.*f" if LEFT) */
+  static const double scale[WRITER_MAXPREC + 1] =
+    {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+      1e13, 1e14, 1e15, 1e16, 1e17
+    };
+  double ax = fabs (x);
+  if ((prec < 0) || (prec > WRITER_MAXPREC) || (width > WRITER_FIXED_MAX)
+      || !isfinite (x) || !(ax * scale[prec] < 0x1.0p52))
+    /* infinities, NaN and large numbers */
+    return writer_printf (w, left ? "%-*.*f" : "%*.*f", width, prec, x);
+
+  /* the exact value of AX * 10^PREC is HI + LO */
+  double hi = ax * scale[prec];
+  double lo = fma (ax, scale[prec], -hi);
+  double whole = floor (hi);
+  uint64_t n = (uint64_t) whole;
+  /* HI - WHOLE - 0.5 is exact, and LO is smaller than any nonzero
+     value it can take, so LO only matters for ties */
+  double d = (hi - whole) - 0.5;
+  if ((d > 0.0) || ((d == 0.0) && ((lo > 0.0) || ((lo == 0.0) && (n & 1)))))
+    n++;
+
+  /* the digits, backwards */
+  char digits[WRITER_FIXED_MAX];
+  char * p = digits + WRITER_FIXED_MAX;
+  for (int i = 0; i < prec; i++, n /= 10)
+    *--p = '0' + n % 10;
+  if (prec > 0)
+    *--p = '.';
+  do
+    {
+      *--p = '0' + n % 10;
+      n /= 10;
+    }
+  while (n > 0);
+  if (signbit (x))
+    *--p = '-';
+
+  size_t len = digits + WRITER_FIXED_MAX - p;
+  size_t pad = (width > (int) len) ? width - len : 0;
+  char * dest = writer_reserve (w, len + pad);
+  if (!left)
+    {
+      memset (dest, ' ', pad);
+      dest += pad;
+    }
+  memcpy (dest, p, len);
+  if (left)
+    memset (dest + len, ' ', pad);
+  w->len += len + pad;
+  return (w->err == 0) ? 0 : -1;
+}
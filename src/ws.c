@@ -0,0 +1,82 @@
+/*
+
+  ws.c: scratch space for simulations that allocate nothing
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson	-- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280
+  <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the
+  Free Software Foundation, either version 3 of the License, or (at your
+  option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+  for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A generation should not need the allocator: rmtable () allocates a
+   mating table every time and geno_marginals () a vector of sums.  A
+   workspace holds those buffers for one genome size, allocated when it
+   is made, and the _ws variants of those functions use them instead.
+   Its mating table keeps its rows in one block, which the packed
+   kernels (see packed.c) read without copying; with it, rec_mating ()
+   allocates nothing either, except for a lazy table's first slices.
+
+   Everything else on the path of a generation needs only a bounded
+   amount of stack.  A workspace belongs to one thread at a time; give
+   each thread its own. */
+
+#include <stdint.h>
+#include <string.h>
+#include "haploid.h"
+
+haploid_ws_t *
+ws_new (size_t nloci)
+{
+  /* a workspace for genomes of NLOCI loci; returns NULL (with errno
+     set to EINVAL) if a mating table for them could not be indexed */
+  if ((nloci < 1) || (nloci >= 4 * sizeof (size_t)))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  size_t geno = (size_t) 1 << nloci;
+  haploid_ws_t * ws = malloc (sizeof (haploid_ws_t));
+  if (ws == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  ws->nloci = nloci;
+  ws->geno = geno;
+  ws->mtable = malloc (geno * sizeof (double *));
+  ws->super = malloc (geno * sizeof (double));
+  double * block = calloc (geno * geno, sizeof (double));
+  if ((ws->mtable == NULL) || (ws->super == NULL) || (block == NULL))
+    error (0, ENOMEM, "Null pointer\n");
+  for (size_t i = 0; i < geno; i++)
+    ws->mtable[i] = block + i * geno;
+  return ws;
+}
+
+void
+ws_free (haploid_ws_t * ws)
+{
+  if (ws == NULL)
+    return;
+  free (ws->mtable[0]);
+  free (ws->mtable);
+  free (ws->super);
+  free (ws);
+}
@@ -0,0 +1,146 @@
+/*
+
+  active_test.c: testing recombination over the active genotypes
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   With a threshold of zero every pair is active and the offspring
+   must match rec_mating () with nothing ignored.  Then run selection
+   toward one genotype for GENS generations both ways: the active set
+   must shrink as alleles fix, and the two runs may differ by no more
+   than the mass the active run reported ignoring, which must be that
+   of the mating table over the pairs with an inactive parent.
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 5
+#define GENO 32
+#define GENS 200
+#define THRESHOLD 1e-12
+#define TOL 1e-14
+
+static void
+active_test_select (double * freqs, const double * W)
+{
+  double wbar = 0.0;
+  for (int i = 0; i < GENO; i++)
+    wbar += freqs[i] * W[i];
+  for (int i = 0; i < GENO; i++)
+    freqs[i] *= W[i] / wbar;
+}
+
+static void
+active_test_free (double ** mtable)
+{
+  for (int i = 0; i < GENO; i++)
+    free (mtable[i]);
+  free (mtable);
+}
+
+int
+main (void)
+{
+  double r[NLOCI] = { 0.1, 0.2, 0.05, 0.3 };
+  double W[GENO];
+  double full[GENO];
+  double part[GENO];
+  double denom = 0.0;
+  srand48 (0);
+  for (int i = 0; i < GENO; i++)
+    {
+      denom += full[i] = drand48 ();
+      W[i] = 1.0 + 0.5 * bits_popcount (i);
+    }
+  for (int i = 0; i < GENO; i++)
+    part[i] = full[i] /= denom;
+
+  haploid_data_t data = { GENO, NLOCI, rec_gen_table (r, GENO) };
+  rec_active_t * a = rec_active_new (data.rec_table, GENO, 0.0);
+  assert (a != NULL);
+  assert (rec_active_count (a) == GENO);
+  data.mtable = rmtable (full, GENO);
+  rec_mating (full, &data);
+  double ignored = rec_active_mating (part, data.mtable, a);
+  active_test_free (data.mtable);
+  assert (islessequal (ignored, TOL));
+  for (int k = 0; k < GENO; k++)
+    assert (islessequal (fabs (full[k] - part[k]), TOL));
+  rec_active_free (a);
+
+  /* selection toward genotype GENO - 1 */
+  a = rec_active_new (data.rec_table, GENO, THRESHOLD);
+  rec_active_reset (a, part);
+  double lost = 0.0;
+  for (int t = 0; t < GENS; t++)
+    {
+      active_test_select (full, W);
+      active_test_select (part, W);
+      data.mtable = rmtable (full, GENO);
+      rec_mating (full, &data);
+      active_test_free (data.mtable);
+      double ** mtable = rmtable (part, GENO);
+      lost += rec_active_mating (part, mtable, a);
+      active_test_free (mtable);
+    }
+  double diff = 0.0;
+  for (int k = 0; k < GENO; k++)
+    diff += fabs (full[k] - part[k]);
+#ifdef DEBUG
+  fprintf (stdout, "%zu active, %g ignored, %g apart\n",
+	   rec_active_count (a), lost, diff);
+#endif
+  assert (rec_active_count (a) < GENO / 4);
+  assert (isgreater (lost, 0.0));
+  assert (islessequal (diff, 2.0 * lost + TOL));
+
+  /* what is reported is the mass of the pairs with an inactive
+     parent (in the full run, the rare genotypes are not zero) */
+  for (int k = 0; k < GENO; k++)
+    part[k] = full[k];
+  rec_active_reset (a, part);
+  data.mtable = rmtable (part, GENO);
+  double outside = 0.0;
+  for (int k = 0; k < GENO; k++)
+    for (int j = 0; j < GENO; j++)
+      if (isless (part[k], THRESHOLD) || isless (part[j], THRESHOLD))
+	outside += data.mtable[k][j];
+  ignored = rec_active_mating (part, data.mtable, a);
+  active_test_free (data.mtable);
+  assert (isgreater (outside, 0.0));
+  assert (islessequal (fabs (ignored - outside), TOL));
+  rec_active_free (a);
+  rec_free_table (data.rec_table, GENO);
+  assert (rec_active_new (NULL, 1, 0.0) == NULL);
+  return 0;
+}
+
+/* end of active_test.c */
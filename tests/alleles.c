@@ -0,0 +1,84 @@
+/*
+
+  alleles.c: testing conversions between alleles and genotypes
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Check allele_to_genotype () and genotype_to_allele () against the
+   definitions computed one genotype and one locus at a time, for
+   genomes small enough to fit in one block of genotypes and large
+   enough to need several.
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define MAXLOCI 12
+#define TOL 1e-13
+
+int
+main (void)
+{
+  srand48 (0);
+  for (size_t nloci = 0; nloci <= MAXLOCI; nloci++)
+    {
+      size_t geno = 1 << nloci;
+      double alleles[nloci + 1];
+      double freqs[geno];
+      for (int j = 0; j < nloci; j++)
+	alleles[j] = drand48 ();
+      allele_to_genotype (alleles, freqs, nloci, geno);
+      for (int i = 0; i < geno; i++)
+	{
+	  double p = 1.0;
+	  for (int j = 0; j < nloci; j++)
+	    p *= bits_isset (i, j) ? alleles[j] : fdim (1.0, alleles[j]);
+	  assert (islessequal (fabs (freqs[i] - p), TOL));
+	}
+
+      /* now arbitrary (non-equilibrium) genotype frequencies: */
+      for (int i = 0; i < geno; i++)
+	freqs[i] = drand48 () / geno;
+      genotype_to_allele (alleles, freqs, nloci, geno);
+      for (int j = 0; j < nloci; j++)
+	{
+	  double p = 0.0;
+	  for (int i = 0; i < geno; i++)
+	    if (bits_isset (i, j))
+	      p += freqs[i];
+#ifdef DEBUG
+	  fprintf (stdout, "p[%x] = %f (%f)\n", j, alleles[j], p);
+#endif
+	  assert (islessequal (fabs (alleles[j] - p), TOL));
+	}
+    }
+  return 0;
+}
+/* end of alleles.c */
@@ -0,0 +1,153 @@
+/*
+
+  async_test.c: testing the asynchronous writer
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Push many records through a small ring that blocks when full: the
+   file must hold all of them, in order.  Then push into a ring that
+   drops records in front of a slow encoder: what is written and what
+   is dropped must add up, and what is written must still be in
+   order.  Finally feed a trajectory file from the writer thread.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+#include "../src/haploid.h"
+
+#define RECORDS 100000
+#define SLOTS 64
+#define GENO 4
+
+typedef struct
+{
+  uint64_t i;
+  double x;
+} rec_t;
+
+static size_t slow_seen = 0;
+static uint64_t slow_last = 0;
+
+static int
+async_test_slow (const void * rec, void * arg)
+{
+  /* an encoder that takes its time and checks the order */
+  const rec_t * r = rec;
+  struct timespec pause = { 0, 1000 };
+  assert ((slow_seen == 0) || (r->i > slow_last));
+  slow_last = r->i;
+  slow_seen++;
+  nanosleep (&pause, NULL);
+  return 0;
+}
+
+int
+main (void)
+{
+  /* back-pressure */
+  FILE * file = tmpfile ();
+  assert (file != NULL);
+  haploid_writer_t * w = writer_new (fileno (file), 0);
+  async_raw_t raw = { w, sizeof (rec_t) };
+  haploid_async_t * a = async_new (sizeof (rec_t), SLOTS, ASYNC_BLOCK,
+				   async_write_raw, &raw);
+  assert (a != NULL);
+  for (uint64_t i = 0; i < RECORDS; i++)
+    {
+      rec_t r = { i, i / 2.0 };
+      assert (async_push (a, &r) == 0);
+    }
+  assert (async_free (a) == 0);
+  assert (writer_free (w) == 0);
+  fflush (file);
+  assert (ftell (file) == RECORDS * sizeof (rec_t));
+  rewind (file);
+  for (uint64_t i = 0; i < RECORDS; i++)
+    {
+      rec_t r;
+      assert (fread (&r, sizeof (r), 1, file) == 1);
+      assert ((r.i == i) && (r.x == i / 2.0));
+    }
+  fclose (file);
+
+  /* dropping */
+  a = async_new (sizeof (rec_t), SLOTS, ASYNC_DROP, async_test_slow, NULL);
+  size_t pushed = 0;
+  for (uint64_t i = 0; i < RECORDS; i++)
+    {
+      rec_t * slot = async_reserve (a);
+      if (slot == NULL)
+	continue;
+      slot->i = i;
+      slot->x = 0.0;
+      async_commit (a);
+      pushed++;
+    }
+  uint64_t dropped = async_dropped (a);
+  assert (async_free (a) == 0);
+#ifdef DEBUG
+  fprintf (stdout, "%zu written, %" PRIu64 " dropped\n", slow_seen, dropped);
+#endif
+  assert (slow_seen == pushed);
+  assert (pushed + dropped == RECORDS);
+
+  /* a trajectory */
+  char path[] = "async_testXXXXXX";
+  int fd = mkstemp (path);
+  assert (fd >= 0);
+  w = writer_new (fd, 0);
+  double r = 0.5;
+  traj_info_t info = { 2, GENO, 0, 10, 0.0, 1, &r, NULL };
+  traj_t * t = traj_open (w, &info);
+  a = async_new ((GENO + 1) * sizeof (double), SLOTS, ASYNC_BLOCK,
+		 async_write_traj, t);
+  for (uint64_t g = 0; g < 1000; g++)
+    {
+      uint64_t * rec = async_reserve (a);
+      rec[0] = g;
+      double * freqs = (double *) (rec + 1);
+      for (int i = 0; i < GENO; i++)
+	freqs[i] = 0.25;
+      async_commit (a);
+    }
+  assert (async_free (a) == 0);
+  assert (traj_close (t) == 0);
+  assert (writer_free (w) == 0);
+  close (fd);
+  traj_map_t * map = traj_map (path);
+  assert ((map != NULL) && (map->nrec == 100));
+  traj_unmap (map);
+  unlink (path);
+  return 0;
+}
+/* end of async_test.c */
@@ -95,7 +95,7 @@ main (void)
 #endif
 
   /* calculate the value with the library routine: */
-  double ld = ld_from_geno (nloci, genotypes, genotype_freqs);
+  double ld = ld_from_geno (genotype_freqs, genotypes);
   fprintf (stdout, "Value by hand: %f\n", hand);
   fprintf (stdout, "Value by ld_from_geno: %f\n", ld);
   _Bool nomatch = (int)(hand - ld);
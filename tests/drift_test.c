@@ -0,0 +1,132 @@
+/*
+
+  drift_test.c: testing the binomial sampler and Wright-Fisher drift
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Draw many binomial variates for parameters that use inversion, the
+   BTRD algorithm and the reflection for p > 1/2, and compare the
+   observed frequency of every value with the binomial probability
+   (allowing six standard errors).  Then check that Wright-Fisher
+   drift keeps frequencies that are multiples of 1/N summing to one,
+   and that a replicate batch loses an allele about as often as
+   theory says.
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define DRAWS 200000
+
+static void
+drift_test_pmf (unsigned long n, double p, haploid_rng_t * rng)
+{
+  unsigned long * seen = calloc (n + 1, sizeof (unsigned long));
+  if (seen == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  for (int d = 0; d < DRAWS; d++)
+    {
+      unsigned long k = rng_binomial (rng, n, p);
+      assert (k <= n);
+      seen[k]++;
+    }
+  for (unsigned long k = 0; k <= n; k++)
+    {
+      double pk = exp (lgamma (n + 1.0) - lgamma (k + 1.0)
+		       - lgamma (n - k + 1.0) + k * log (p)
+		       + (n - k) * log1p (-p));
+      double se = sqrt (pk * (1.0 - pk) / DRAWS);
+      double obs = (double) seen[k] / DRAWS;
+#ifdef DEBUG
+      if (pk > 1e-4)
+	fprintf (stdout, "n = %lu p = %g: P(%lu) = %f (%f)\n", n, p, k,
+		 obs, pk);
+#endif
+      assert (islessequal (fabs (obs - pk), 6.0 * se + 1e-5));
+    }
+  free (seen);
+}
+
+int
+main (void)
+{
+  haploid_rng_t rng;
+  rng_init (&rng, 0, 0, 0, 0);
+  drift_test_pmf (20, 0.1, &rng);
+  drift_test_pmf (40, 0.2, &rng);
+  drift_test_pmf (100, 0.3, &rng);
+  drift_test_pmf (1000, 0.5, &rng);
+  drift_test_pmf (500, 0.97, &rng);
+  drift_test_pmf (100000, 0.01, &rng);
+
+  /* drift */
+  const unsigned long N = 1000;
+  double freqs[4] = { 0.1, 0.2, 0.3, 0.4 };
+  for (int gen = 0; gen < 100; gen++)
+    {
+      assert (drift_wf (freqs, 4, N, &rng) == 0);
+      double total = 0.0;
+      for (int i = 0; i < 4; i++)
+	{
+	  double count = freqs[i] * N;
+	  assert (islessequal (fabs (count - nearbyint (count)), 1e-9));
+	  total += freqs[i];
+	}
+      assert (islessequal (fabs (total - 1.0), 1e-12));
+    }
+
+  /* a neutral allele at frequency p is fixed with probability p */
+  enum { NREP = 2000, GENS = 200 };
+  const unsigned long small = 20;
+  double * batch = malloc (NREP * 2 * sizeof (double));
+  if (batch == NULL)
+    error (0, ENOMEM, "Null pointer\n");
+  for (int rep = 0; rep < NREP; rep++)
+    {
+      batch[2 * rep] = 0.25;
+      batch[2 * rep + 1] = 0.75;
+    }
+  for (int gen = 0; gen < GENS; gen++)
+    assert (drift_wf_batch (batch, 2, NREP, small, &rng) == 0);
+  int fixed = 0;
+  for (int rep = 0; rep < NREP; rep++)
+    fixed += (batch[2 * rep] == 1.0);
+  double se = sqrt (0.25 * 0.75 / NREP);
+#ifdef DEBUG
+  fprintf (stdout, "fixed in %d of %d\n", fixed, NREP);
+#endif
+  assert (islessequal (fabs ((double) fixed / NREP - 0.25), 6.0 * se));
+  free (batch);
+
+  /* no sample of no individuals */
+  assert ((drift_wf (freqs, 4, 0, &rng) == -1) && (errno == EINVAL));
+  return 0;
+}
+/* end of drift_test.c */
@@ -0,0 +1,193 @@
+/*
+
+  ensemble_test.c: testing the ensemble reducer
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Reduce a few thousand replicates of three statistics (one partly
+   NAN, one partly outside its bins) and compare the moments with a
+   two-pass calculation and the quantiles with sorted data, to within a
+   bin; the 0 and 1 quantiles must be the extremes.  Reducing the replicates in four parts and merging must agree
+   with reducing them at once, exactly for the counts, and merging the
+   same parts in the same order must give the same bits.  Finally a
+   serialized reducer must read back unchanged.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define REPS 4000
+#define NSTAT 3
+#define NBINS 200
+#define PARTS 4
+
+static int
+ensemble_test_cmp (const void * a, const void * b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+static ens_t *
+ensemble_test_parts (double (*x)[NSTAT], double * lo, double * hi)
+{
+  /* reduce X in PARTS pieces and merge them in order */
+  ens_t * part[PARTS];
+  for (int p = 0; p < PARTS; p++)
+    {
+      part[p] = ens_new (NSTAT, NBINS, lo, hi);
+      for (int k = p; k < REPS; k += PARTS)
+	ens_add (part[p], x[k]);
+    }
+  for (int p = 1; p < PARTS; p++)
+    {
+      assert (ens_merge (part[0], part[p]) == 0);
+      ens_free (part[p]);
+    }
+  return part[0];
+}
+
+int
+main (void)
+{
+  static double x[REPS][NSTAT];
+  double lo[NSTAT] = { 0.0, -1.0, 0.0 };
+  double hi[NSTAT] = { 1.0, 1.0, 100.0 };
+  srand48 (0);
+  for (int k = 0; k < REPS; k++)
+    {
+      x[k][0] = drand48 ();
+      /* some of these fall outside the bins */
+      x[k][1] = (drand48 () + drand48 () + drand48 () - 1.5);
+      /* a "time to fixation" that is sometimes undefined */
+      x[k][2] = (drand48 () < 0.2) ? NAN : floor (-20.0 * log (drand48 ()));
+    }
+
+  ens_t * e = ens_new (NSTAT, NBINS, lo, hi);
+  for (int k = 0; k < REPS; k++)
+    ens_add (e, x[k]);
+
+  for (int i = 0; i < NSTAT; i++)
+    {
+      double col[REPS];
+      size_t n = 0;
+      double mean = 0.0, var = 0.0;
+      for (int k = 0; k < REPS; k++)
+	if (!isnan (x[k][i]))
+	  mean += col[n++] = x[k][i];
+      mean /= n;
+      for (size_t k = 0; k < n; k++)
+	var += (col[k] - mean) * (col[k] - mean);
+      var /= n - 1;
+      assert (ens_count (e, i) == n);
+      assert (fabs (ens_mean (e, i) - mean) < 1e-12);
+      assert (fabs (ens_var (e, i) - var) < 1e-12);
+
+      qsort (col, n, sizeof (double), ensemble_test_cmp);
+      double width = (hi[i] - lo[i]) / NBINS;
+      for (double q = 0.05; q < 1.0; q += 0.15)
+	{
+	  double exact = col[(size_t) (q * n)];
+	  double est = ens_quantile (e, i, q);
+#ifdef DEBUG
+	  fprintf (stdout, "stat %d q %.2f: %f (%f)\n", i, q, est, exact);
+#endif
+	  /* inside the bins: within about a bin; outside: at the
+	     extremes */
+	  if ((exact > lo[i] + width) && (exact < hi[i] - width))
+	    assert (fabs (est - exact) < 2.0 * width);
+	  else
+	    assert ((est >= col[0]) && (est <= col[n - 1]));
+	}
+    }
+
+  /* merging */
+  ens_t * merged = ensemble_test_parts (x, lo, hi);
+  ens_t * again = ensemble_test_parts (x, lo, hi);
+  for (int i = 0; i < NSTAT; i++)
+    {
+      assert (ens_count (merged, i) == ens_count (e, i));
+      assert (fabs (ens_mean (merged, i) - ens_mean (e, i)) < 1e-12);
+      assert (fabs (ens_var (merged, i) - ens_var (e, i)) < 1e-12);
+      assert (ens_quantile (merged, i, 0.5) == ens_quantile (e, i, 0.5));
+    }
+  /* the extremes are known exactly, also when every value of the
+     first statistic is in its bins */
+  for (int i = 0; i < NSTAT; i++)
+    {
+      double min = INFINITY, max = -INFINITY;
+      for (int k = 0; k < REPS; k++)
+	if (!isnan (x[k][i]))
+	  {
+	    min = fmin (min, x[k][i]);
+	    max = fmax (max, x[k][i]);
+	  }
+      assert (ens_quantile (e, i, 0.0) == min);
+      assert (ens_quantile (e, i, 1.0) == max);
+    }
+  assert (memcmp (merged->stats, again->stats,
+		  NSTAT * sizeof (ens_stat_t)) == 0);
+  assert (memcmp (merged->bins, e->bins,
+		  NSTAT * NBINS * sizeof (uint64_t)) == 0);
+
+  /* a mismatched shape */
+  ens_t * other = ens_new (NSTAT, NBINS + 1, lo, hi);
+  assert (ens_merge (e, other) == -1);
+  ens_free (other);
+
+  /* serialization */
+  FILE * file = tmpfile ();
+  haploid_writer_t * w = writer_new (fileno (file), 0);
+  assert (ens_write (w, merged) == 0);
+  assert (writer_free (w) == 0);
+  size_t len = ens_size (merged);
+  fflush (file);
+  assert (ftell (file) == (long) len);
+  rewind (file);
+  char * buf = malloc (len);
+  assert (fread (buf, 1, len, file) == len);
+  ens_t * read = ens_read (buf, len);
+  assert (read != NULL);
+  assert (memcmp (read->stats, merged->stats,
+		  NSTAT * sizeof (ens_stat_t)) == 0);
+  assert (memcmp (read->bins, merged->bins,
+		  NSTAT * NBINS * sizeof (uint64_t)) == 0);
+  assert (ens_read (buf, len - 1) == NULL);
+  free (buf);
+  fclose (file);
+
+  ens_free (e);
+  ens_free (merged);
+  ens_free (again);
+  ens_free (read);
+  return 0;
+}
+/* end of ensemble_test.c */
@@ -0,0 +1,177 @@
+/*
+
+  exec_test.c: testing trials on threads that steal work
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Trials as in tlta.c, with random starting alleles, run until both
+   alleles fix, CHUNK generations at a time: some finish at once and
+   some take thousands of generations.  One thread, several threads,
+   and a plain loop over the trials must give the same results to the
+   bit, in trial order.  Then a task that fails for odd trials.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 2
+#define GENO 4
+#define TRIALS 64
+#define CHUNK 10
+#define MAXGENS 100000
+
+typedef struct exec_test_t exec_test_t;
+struct exec_test_t
+{
+  haploid_data_t data;		/* shared tables */
+  const double * W;
+  double freqs[TRIALS][GENO];	/* each trial's state */
+  int gens[TRIALS];
+};
+
+typedef struct exec_test_result_t exec_test_result_t;
+struct exec_test_result_t
+{
+  double alleles[NLOCI];
+  int gens;
+};
+
+static int
+exec_test_task (exec_ctx_t * ctx, void * arg)
+{
+  /* CHUNK more generations of trial CTX->trial */
+  exec_test_t * e = arg;
+  double * freqs = e->freqs[ctx->trial];
+  double alleles[NLOCI];
+  double goal[NLOCI] = { 1.0, 1.0 };
+  haploid_data_t data = e->data;
+  if (e->gens[ctx->trial] == 0)
+    {
+      /* a quarter of the trials start with both alleles fixed, and
+	 the others with alleles of every order of magnitude */
+      for (int j = 0; j < NLOCI; j++)
+	alleles[j] = (ctx->trial % 4 == 0)
+	  ? 1.0 : pow (rng_uniform (ctx->rng), 1 + ctx->trial % 8);
+      allele_to_genotype (alleles, freqs, NLOCI, GENO);
+    }
+  for (int t = 0; t < CHUNK; t++)
+    {
+      genotype_to_allele (alleles, freqs, NLOCI, GENO);
+      if (!sim_stop_ck (alleles, goal, NLOCI, 1e-8)
+	  || (e->gens[ctx->trial] == MAXGENS))
+	{
+	  exec_test_result_t * result = ctx->result;
+	  memcpy (result->alleles, alleles, sizeof (alleles));
+	  result->gens = e->gens[ctx->trial];
+	  return EXEC_DONE;
+	}
+      double wbar = gen_mean (freqs, (double *) e->W, GENO);
+      for (int i = 0; i < GENO; i++)
+	freqs[i] *= e->W[i] / wbar;
+      data.mtable = rmtable_ws (freqs, ctx->ws);
+      rec_mating (freqs, &data);
+      e->gens[ctx->trial]++;
+    }
+  return EXEC_YIELD;
+}
+
+static int
+exec_test_fail (exec_ctx_t * ctx, void * arg)
+{
+  return (ctx->trial % 2) ? -1 : EXEC_DONE;
+}
+
+int
+main (void)
+{
+  /* weak additive selection, so that rare alleles take long to fix */
+  double W[GENO] = { 1.0, 1.02, 1.02, 1.04 };
+  double r = 0.25;
+  haploid_model_t * model = model_new (NLOCI, &r);
+  static exec_test_t e;
+  e.data = model_data (model);
+  e.W = W;
+  exec_test_result_t results[3][TRIALS];
+  /* the padding of results is compared too */
+  memset (results, 0, sizeof (results));
+  uint64_t seed = 7;
+
+  /* by hand, each trial to the end in turn */
+  haploid_ws_t * ws = ws_new (NLOCI);
+  memset (e.gens, 0, sizeof (e.gens));
+  for (size_t t = 0; t < TRIALS; t++)
+    {
+      haploid_rng_t rng;
+      rng_init (&rng, seed, 0, t, 0);
+      exec_ctx_t ctx = { t, 0, &rng, ws, results[0] + t };
+      while (exec_test_task (&ctx, &e) == EXEC_YIELD)
+	;
+    }
+  ws_free (ws);
+
+  size_t nthreads[2] = { 1, 4 };
+  for (int n = 0; n < 2; n++)
+    {
+      haploid_exec_t * exec = exec_new (nthreads[n], NLOCI);
+      assert ((exec != NULL) && (exec_nthreads (exec) == nthreads[n]));
+      memset (e.gens, 0, sizeof (e.gens));
+      assert (exec_run (exec, TRIALS, exec_test_task, &e, seed,
+			results[n + 1], sizeof (exec_test_result_t)) == 0);
+      uint64_t steals, yields;
+      exec_counts (exec, &steals, &yields);
+#ifdef DEBUG
+      fprintf (stdout, "%zu threads: %lu steals, %lu yields\n", nthreads[n],
+	       (unsigned long) steals, (unsigned long) yields);
+#endif
+      assert (yields > 0);
+      if (nthreads[n] == 1)
+	assert (steals == 0);
+      assert (memcmp (results[0], results[n + 1], sizeof (results[0])) == 0);
+
+      /* failures are counted, and the run still ends */
+      assert (exec_run (exec, 9, exec_test_fail, NULL, seed, NULL, 0) == 4);
+      exec_free (exec);
+    }
+
+  /* the lengths of the trials vary */
+  int shortest = MAXGENS, longest = 0;
+  for (int t = 0; t < TRIALS; t++)
+    {
+      shortest = (results[0][t].gens < shortest) ? results[0][t].gens : shortest;
+      longest = (results[0][t].gens > longest) ? results[0][t].gens : longest;
+    }
+  assert ((shortest == 0) && (longest > 10 * CHUNK));
+  exec_free (NULL);
+  model_unref (model);
+  return 0;
+}
+
+/* end of exec_test.c */
@@ -0,0 +1,108 @@
+/*
+
+  fixed_test.c: testing the kernels for small genomes
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   For one to REC_FIXED_MAXLOCI loci, rec_mating () runs a kernel that
+   walks the recombination map instead of the table; it must give the
+   offspring frequencies of the linked table, for random and
+   non-random (even asymmetric) mating tables alike, and for maps with
+   intervals that always or never recombine.  A map of our own in
+   rec_fixed must do the same without any table.
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+#include "../src/sparse.h"
+
+#define TOL 1e-14
+
+int
+main (void)
+{
+  srand48 (0);
+  for (size_t nloci = 1; nloci <= REC_FIXED_MAXLOCI; nloci++)
+    for (int map = 0; map < 2; map++)
+      {
+	size_t geno = 1 << nloci;
+	double r[nloci];
+	double freqs[geno];
+	double linked[geno];
+	double own[geno];
+	double denom = 0.0;
+	for (int j = 0; j < nloci; j++)
+	  {
+	    int kind = (map == 0) ? 2 : lrand48 () % 3;
+	    r[j] = (kind == 0) ? 0.0 : (kind == 1) ? 1.0 : drand48 () / 2.0;
+	  }
+	for (int i = 0; i < geno; i++)
+	  denom += freqs[i] = drand48 ();
+	for (int i = 0; i < geno; i++)
+	  freqs[i] /= denom;
+
+	haploid_data_t data = { geno, nloci, rec_gen_table (r, geno),
+				rmtable (freqs, geno) };
+	/* skew the mating table away from random mating, and away
+	   from symmetry */
+	for (int i = 0; i < geno; i++)
+	  for (int j = i; j < geno; j++)
+	    data.mtable[i][j] *= (i == j) ? 2.0 : 1.5;
+
+	for (int k = 0; k < geno; k++)
+	  linked[k] = sparse_mat_tot (geno, data.mtable, data.rec_table[k]);
+	rec_mating (freqs, &data);
+	rtable_t ** rtable = data.rec_table;
+	data.rec_table = NULL;
+	data.rec_fixed = rec_fixed_table (r, geno);
+	assert (data.rec_fixed != NULL);
+	rec_mating (own, &data);
+	for (int k = 0; k < geno; k++)
+	  {
+#ifdef DEBUG
+	    fprintf (stdout, "x[%x] = %f (%f)\n", k, freqs[k], linked[k]);
+#endif
+	    assert (islessequal (fabs (freqs[k] - linked[k]), TOL));
+	    assert (own[k] == freqs[k]);
+	  }
+	rec_fixed_free (data.rec_fixed);
+	rec_free_table (rtable, geno);
+	for (int i = 0; i < geno; i++)
+	  free (data.mtable[i]);
+	free (data.mtable);
+      }
+  /* no kernel for a genome this size: */
+  double r[REC_FIXED_MAXLOCI] = { 0.0 };
+  errno = 0;
+  assert (rec_fixed_table (r, 1 << (REC_FIXED_MAXLOCI + 1)) == NULL);
+  assert (errno == EINVAL);
+  return 0;
+}
+/* end of fixed_test.c */
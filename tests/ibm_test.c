@@ -0,0 +1,181 @@
+/*
+
+  ibm_test.c: testing the individual-based simulation
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   One generation of a large individual-based population must match
+   the deterministic recursion (selection, then rec_mating () with a
+   random mating table) started from the population's own frequencies,
+   up to six standard errors.  Then check genomes spanning several
+   words: without recombination every offspring is a copy of a parent,
+   with a sparse map crossovers fall only where it allows and as often,
+   and with free recombination the allele frequency at each locus stays
+   near one half.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 3
+#define GENO 8
+#define N 200000
+#define BIGLOCI 130
+#define BIGN 2000
+#define LASTWORD ((UINT64_C(1) << (BIGLOCI % 64)) - 1)
+
+static void
+ibm_test_founders (ibm_t * pop)
+{
+  /* half the genomes carry allele 1 at every locus; unused bits of the
+     last word stay zero */
+  for (size_t k = 0; k < BIGN / 2; k++)
+    {
+      uint64_t * g = pop->genomes + k * pop->nwords;
+      memset (g, 0xff, pop->nwords * sizeof (uint64_t));
+      g[pop->nwords - 1] = LASTWORD;
+    }
+}
+
+int
+main (void)
+{
+  haploid_rng_t rng;
+  double freqs[GENO];
+  double W[GENO];
+  double r[NLOCI];
+  double expect[GENO];
+  double denom = 0.0;
+  srand48 (0);
+  rng_init (&rng, 0, 0, 0, 0);
+  for (int i = 0; i < GENO; i++)
+    {
+      denom += freqs[i] = drand48 ();
+      W[i] = 1.0 + drand48 ();
+    }
+  for (int i = 0; i < GENO; i++)
+    freqs[i] /= denom;
+  for (int j = 0; j < NLOCI; j++)
+    r[j] = drand48 () / 2.0;
+
+  ibm_t * pop = ibm_new (NLOCI, N, r);
+  assert (pop != NULL);
+  ibm_from_freqs (pop, freqs, GENO, &rng);
+  ibm_freqs (pop, freqs, GENO);
+
+  /* the deterministic prediction */
+  double wbar = 0.0;
+  for (int i = 0; i < GENO; i++)
+    wbar += freqs[i] * W[i];
+  for (int i = 0; i < GENO; i++)
+    freqs[i] *= W[i] / wbar;
+  haploid_data_t data = { GENO, NLOCI, rec_gen_table (r, GENO),
+			  rmtable (freqs, GENO) };
+  rec_mating (expect, &data);
+
+  assert (ibm_generation (pop, W, &rng) == 0);
+  ibm_freqs (pop, freqs, GENO);
+  for (int i = 0; i < GENO; i++)
+    {
+      double se = sqrt (expect[i] * (1.0 - expect[i]) / N);
+#ifdef DEBUG
+      fprintf (stdout, "x[%x] = %f (%f)\n", i, freqs[i], expect[i]);
+#endif
+      assert (islessequal (fabs (freqs[i] - expect[i]), 6.0 * se));
+    }
+  ibm_free (pop);
+
+  /* several words per genome */
+  double bigr[BIGLOCI];
+  for (int j = 0; j < BIGLOCI; j++)
+    bigr[j] = 0.0;
+  pop = ibm_new (BIGLOCI, BIGN, bigr);
+  assert (pop->nwords == 3);
+  ibm_test_founders (pop);
+  assert (ibm_generation (pop, NULL, &rng) == 0);
+  size_t ones = 0;
+  for (size_t k = 0; k < BIGN; k++)
+    {
+      uint64_t * g = pop->genomes + k * pop->nwords;
+      for (size_t w = 1; w < pop->nwords - 1; w++)
+	assert (g[w] == g[0]);
+      assert ((g[0] == 0) || (g[0] == UINT64_MAX));
+      assert (g[pop->nwords - 1] == (g[0] & LASTWORD));
+      ones += (g[0] != 0);
+    }
+  assert ((ones > 0) && (ones < BIGN));
+  /* no fitness by genotype index for this many loci */
+  assert ((ibm_generation (pop, W, &rng) == -1) && (errno == EINVAL));
+  ibm_free (pop);
+
+  /* few crossovers, placed by their gaps: only in the intervals that
+     recombine, and as many as the map says in the half of the
+     offspring whose parents differ */
+  double sum = 0.0;
+  for (int j = 0; j < BIGLOCI - 1; j++)
+    sum += bigr[j] = (j % 2) ? 0.0 : (j % 4) ? 0.01 : 0.02;
+  pop = ibm_new (BIGLOCI, BIGN, bigr);
+  ibm_test_founders (pop);
+  assert (ibm_generation (pop, NULL, &rng) == 0);
+  size_t switches = 0;
+  for (size_t k = 0; k < BIGN; k++)
+    for (int j = 0; j < BIGLOCI - 1; j++)
+      {
+	const uint64_t * g = pop->genomes + k * pop->nwords;
+	int here = (g[j / 64] >> (j % 64)) & 1;
+	int next = (g[(j + 1) / 64] >> ((j + 1) % 64)) & 1;
+	assert ((here == next) || (j % 2 == 0));
+	switches += (here != next);
+      }
+#ifdef DEBUG
+  fprintf (stdout, "%g crossovers per offspring (%g)\n",
+	   (double) switches / BIGN, sum / 2.0);
+#endif
+  assert (fabs ((double) switches / BIGN - sum / 2.0) < 6.0 * sqrt (1.1 / BIGN));
+  ibm_free (pop);
+
+  for (int j = 0; j < BIGLOCI; j++)
+    bigr[j] = 0.5;
+  pop = ibm_new (BIGLOCI, BIGN, bigr);
+  ibm_test_founders (pop);
+  assert (ibm_generation (pop, NULL, &rng) == 0);
+  for (int j = 0; j < BIGLOCI; j++)
+    {
+      size_t count = 0;
+      for (size_t k = 0; k < BIGN; k++)
+	count += (pop->genomes[k * pop->nwords + j / 64] >> (j % 64)) & 1;
+      /* drift in one generation plus sampling, generously */
+      assert (fabs ((double) count / BIGN - 0.5) < 0.1);
+    }
+  ibm_free (pop);
+  return 0;
+}
+/* end of ibm_test.c */
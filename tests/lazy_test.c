@@ -0,0 +1,158 @@
+/*
+
+  lazy_test.c: testing recombination tables built on demand
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Every slice of a lazy table must hold exactly the entries of the
+   same slice of rec_gen_table (), for maps with intervals of 0, 1 and
+   in between, and rec_mating () through a lazy table must agree with
+   the eager table.  Then check the hit and miss counts of a cache of
+   two slices under each policy, and that a full cache takes what
+   mem_estimate () said it would.
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define MAXLOCI 5
+#define TOL 1e-15
+
+static size_t
+lazy_test_len (rtable_t * slice)
+{
+  size_t n = 0;
+  for (; slice != NULL; slice = slice->next)
+    n++;
+  return n;
+}
+
+static double
+lazy_test_val (rtable_t * slice, int i, int j)
+{
+  for (; slice != NULL; slice = slice->next)
+    if ((slice->indices[0] == i) && (slice->indices[1] == j))
+      return slice->val;
+  return 0.0;
+}
+
+int
+main (void)
+{
+  srand48 (0);
+  for (size_t nloci = 1; nloci <= MAXLOCI; nloci++)
+    {
+      size_t geno = 1 << nloci;
+      double r[nloci];
+      double freqs[geno];
+      double eager[geno];
+      double denom = 0.0;
+      for (int j = 0; j < nloci; j++)
+	{
+	  int kind = lrand48 () % 4;
+	  r[j] = (kind == 0) ? 0.0 : (kind == 1) ? 1.0 : drand48 () / 2.0;
+	}
+      for (int i = 0; i < geno; i++)
+	denom += freqs[i] = drand48 ();
+      for (int i = 0; i < geno; i++)
+	freqs[i] /= denom;
+
+      haploid_data_t data = { geno, nloci, rec_gen_table (r, geno),
+			      rmtable (freqs, geno) };
+      rec_lazy_t * lazy = rec_lazy_new (r, geno, 0, REC_LAZY_LRU);
+      assert (lazy != NULL);
+      for (uint k = 0; k < geno; k++)
+	{
+	  rtable_t * slice = rec_lazy_get (lazy, k);
+	  assert (lazy_test_len (slice) == lazy_test_len (data.rec_table[k]));
+	  for (; slice != NULL; slice = slice->next)
+	    assert (slice->val == lazy_test_val (data.rec_table[k],
+						 slice->indices[0],
+						 slice->indices[1]));
+	}
+      rec_mating (eager, &data);
+      rec_free_table (data.rec_table, geno);
+      data.rec_table = NULL;
+      data.rec_lazy = lazy;
+      rec_mating (freqs, &data);
+      for (int k = 0; k < geno; k++)
+	{
+#ifdef DEBUG
+	  fprintf (stdout, "x[%x] = %f (%f)\n", k, freqs[k], eager[k]);
+#endif
+	  assert (islessequal (fabs (freqs[k] - eager[k]), TOL));
+	}
+
+      /* every slice was built once, then found */
+      uint64_t hits, misses;
+      rec_lazy_counts (lazy, &hits, &misses);
+      assert ((hits == geno) && (misses == geno));
+      haploid_mem_t est, use;
+      mem_estimate (nloci, r, &est);
+      mem_usage (&data, &use);
+      assert (use.lazy == est.lazy);
+      rec_lazy_free (lazy);
+    }
+
+  /* a cache of two slices */
+  double r[4] = { 0.1, 0.2, 0.3, 0.4 };
+  rec_lazy_t * lazy = rec_lazy_new (r, 16, 0, REC_LAZY_LRU);
+  haploid_data_t data = { 16, 4, NULL };
+  haploid_mem_t before, after;
+  data.rec_lazy = lazy;
+  mem_usage (&data, &before);
+  rec_lazy_get (lazy, 0);
+  mem_usage (&data, &after);
+  rec_lazy_free (lazy);
+  size_t slice = after.lazy - before.lazy;
+
+  for (int policy = REC_LAZY_LRU; policy <= REC_LAZY_FIFO; policy++)
+    {
+      uint64_t hits, misses;
+      lazy = rec_lazy_new (r, 16, 2 * slice, policy);
+      rec_lazy_get (lazy, 0);
+      rec_lazy_get (lazy, 1);
+      rec_lazy_get (lazy, 0);
+      /* evicts 1 if the least recently used, 0 if the first in */
+      rec_lazy_get (lazy, 2);
+      rec_lazy_get (lazy, 0);
+      rec_lazy_counts (lazy, &hits, &misses);
+      if (policy == REC_LAZY_LRU)
+	assert ((hits == 2) && (misses == 3));
+      else
+	assert ((hits == 1) && (misses == 4));
+      rec_lazy_free (lazy);
+    }
+  assert (rec_lazy_new (r, 12, 0, REC_LAZY_LRU) == NULL);
+  assert (rec_lazy_new (r, 16, 0, 2) == NULL);
+  return 0;
+}
+
+/* end of lazy_test.c */
@@ -0,0 +1,78 @@
+/*
+
+  ld_all.c: testing ld_all_geno against ld_sub_geno
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   ld_all_geno () should give, for every mask of loci, exactly what
+   ld_sub_geno () gives for that mask; check this for random genotype
+   frequencies over a range of genome sizes, both into a separate
+   array and in place.
+
+*/
+#include <stdio.h>
+#include <float.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define MAXLOCI 10
+#define TOL 1e-12
+
+int
+main (void)
+{
+  srand48 (0);
+  for (size_t nloci = 1; nloci <= MAXLOCI; nloci++)
+    {
+      size_t geno = 1 << nloci;
+      double freqs[geno];
+      double ld[geno];
+      double denom = 0.0;
+      for (int i = 0; i < geno; i++)
+	denom += freqs[i] = drand48 ();
+      for (int i = 0; i < geno; i++)
+	freqs[i] /= denom;
+
+      ld_all_geno (freqs, ld, geno);
+      for (uint s = 0; s < geno; s++)
+	{
+	  double one = ld_sub_geno (freqs, s, geno);
+#ifdef DEBUG
+	  fprintf (stdout, "D[%x] = %f (%f)\n", s, ld[s], one);
+#endif
+	  assert (islessequal (fabs (ld[s] - one), TOL));
+	}
+      /* in place: */
+      ld_all_geno (freqs, freqs, geno);
+      for (int s = 0; s < geno; s++)
+	assert (islessequal (fabs (ld[s] - freqs[s]), DBL_EPSILON));
+    }
+  return 0;
+}
+/* end of ld_all.c */
@@ -0,0 +1,99 @@
+/*
+
+  marginals.c: testing batch haplotype marginals
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   geno_marginals () should agree with a direct scan of the genotype
+   frequencies for every mask, including the empty mask (a single
+   entry holding the total) and the full mask (the genotype
+   frequencies themselves).
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 8
+#define GENO 256
+#define NMASKS 6
+#define TOL 1e-12
+
+int
+main (void)
+{
+  double freqs[GENO];
+  double denom = 0.0;
+  srand48 (0);
+  for (int i = 0; i < GENO; i++)
+    denom += freqs[i] = drand48 ();
+  for (int i = 0; i < GENO; i++)
+    freqs[i] /= denom;
+
+  uint masks[NMASKS] = { 0x0, 0x3, 0x81, 0x2a, 0xf0, GENO - 1 };
+  double * marginals[NMASKS];
+  for (int q = 0; q < NMASKS; q++)
+    {
+      marginals[q] = malloc ((1 << bits_popcount (masks[q]))
+			     * sizeof (double));
+      if (marginals[q] == NULL)
+	error (0, ENOMEM, "Null pointer\n");
+    }
+  geno_marginals (freqs, GENO, masks, NMASKS, marginals);
+
+  for (int q = 0; q < NMASKS; q++)
+    {
+      uint mask = masks[q];
+      size_t len = 1 << bits_popcount (mask);
+      double hand[len];
+      for (int h = 0; h < len; h++)
+	hand[h] = 0.0;
+      /* pack the masked bits of each genotype by hand */
+      for (uint i = 0; i < GENO; i++)
+	{
+	  uint h = 0;
+	  int pos = 0;
+	  for (int j = 0; j < NLOCI; j++)
+	    if (bits_isset (mask, j))
+	      h |= bits_isset (i, j) << pos++;
+	  hand[h] += freqs[i];
+	}
+      for (int h = 0; h < len; h++)
+	{
+#ifdef DEBUG
+	  fprintf (stdout, "mask %02x: x[%x] = %f (%f)\n",
+		   mask, h, marginals[q][h], hand[h]);
+#endif
+	  assert (islessequal (fabs (marginals[q][h] - hand[h]), TOL));
+	}
+      free (marginals[q]);
+    }
+  return 0;
+}
+/* end of marginals.c */
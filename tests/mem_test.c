@@ -0,0 +1,118 @@
+/*
+
+  mem_test.c: testing the memory estimator against built tables
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   For every genome up to MAXLOCI loci, and recombination maps whose
+   intervals are at random 0, 1 or in between, the predicted number of
+   entries must be the number rec_gen_table () makes, and the predicted
+   bytes must be what mem_usage () finds in the built model.  With no
+   recombination and with free recombination the counts have closed
+   forms, which are checked for larger genomes, along with saturation
+   when the count does not fit.
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define MAXLOCI 5
+#define MAPS 8
+
+int
+main (void)
+{
+  srand48 (0);
+  for (size_t nloci = 1; nloci <= MAXLOCI; nloci++)
+    for (int map = 0; map < MAPS; map++)
+      {
+	size_t geno = 1 << nloci;
+	double r[nloci];
+	double freqs[geno];
+	for (int j = 0; j < nloci; j++)
+	  {
+	    int kind = (map == 0) ? 2 : lrand48 () % 3;
+	    r[j] = (kind == 0) ? 0.0 : (kind == 1) ? 1.0 : drand48 () / 2.0;
+	  }
+	for (int i = 0; i < geno; i++)
+	  freqs[i] = 1.0 / geno;
+
+	haploid_mem_t est;
+	haploid_mem_t use;
+	assert (mem_estimate (nloci, r, &est) == 0);
+	haploid_data_t data = { geno, nloci, rec_gen_table (r, geno),
+				rmtable (freqs, geno) };
+	data.rec_fixed = rec_fixed_table (r, geno);
+	mem_usage (&data, &use);
+#ifdef DEBUG
+	fprintf (stdout, "%zu loci: %zu entries (%zu), %zu bytes (%zu)\n",
+		 nloci, est.nnz, use.nnz, est.list, use.list);
+#endif
+	assert (est.nnz == use.nnz);
+	assert (est.list == use.list);
+	assert ((est.fixed == use.fixed) && (est.fixed > 0));
+	assert ((est.mtable == use.mtable)
+		&& (est.mtable >= geno * geno * sizeof (double)));
+	rec_fixed_free (data.rec_fixed);
+	rec_free_table (data.rec_table, geno);
+	data.rec_table = NULL;
+	data.rec_fixed = NULL;
+	mem_usage (&data, &use);
+	assert ((use.nnz == 0) && (use.list == 0) && (use.fixed == 0));
+      }
+
+  /* closed forms: 2 * GENO - 1 parents per offspring without
+     recombination, and 3^NLOCI with free recombination */
+  double none[60];
+  double loose[60];
+  for (int j = 0; j < 60; j++)
+    {
+      none[j] = 0.0;
+      loose[j] = 0.5;
+    }
+  size_t pow3 = 1;
+  for (size_t nloci = 1; nloci <= 20; nloci++)
+    {
+      size_t geno = (size_t) 1 << nloci;
+      pow3 *= 3;
+      assert (mem_nnz (nloci, none) == geno * (2 * geno - 1));
+      assert (mem_nnz (nloci, loose) == geno * pow3);
+    }
+  haploid_mem_t big;
+  assert (mem_estimate (40, loose, &big) == 0);
+  assert ((big.nnz == SIZE_MAX) && (big.list == SIZE_MAX));
+  assert (big.fixed == 0);
+  assert (mem_nnz (30, none)
+	  == ((size_t) 1 << 30) * (((size_t) 1 << 31) - 1));
+  assert ((mem_estimate (0, loose, &big) == -1) && (errno == EINVAL));
+  return 0;
+}
+
+/* end of mem_test.c */
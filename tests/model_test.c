@@ -0,0 +1,153 @@
+/*
+
+  model_test.c: testing models shared between threads
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Run one population per starting point on a single thread, then the
+   same populations on NTHREADS threads sharing one model, each thread
+   dropping its own reference when it is done: the frequencies must
+   agree to the bit, and match rec_mating () on tables of our own.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "../src/haploid.h"
+
+#define NLOCI 4
+#define GENO 16
+#define GENS 50
+#define NTHREADS 4
+#define NPOPS 8
+
+typedef struct model_test_arg_t model_test_arg_t;
+struct model_test_arg_t
+{
+  haploid_model_t * model;
+  const double * W;
+  double (* freqs)[GENO];	/* NPOPS starting points, overwritten */
+  int first;			/* this thread's populations */
+};
+
+static void
+model_test_run (haploid_model_t * model, const double * W, double * freqs)
+{
+  /* GENS generations from FREQS, left in FREQS */
+  haploid_pop_t * pop = pop_new (model, freqs);
+  for (int t = 0; t < GENS; t++)
+    pop_generation (pop, W);
+  memcpy (freqs, pop->freqs, GENO * sizeof (double));
+  pop_free (pop);
+}
+
+static void *
+model_test_thread (void * arg)
+{
+  model_test_arg_t * a = arg;
+  for (int p = a->first; p < NPOPS; p += NTHREADS)
+    model_test_run (a->model, a->W, a->freqs[p]);
+  model_unref (a->model);
+  return NULL;
+}
+
+int
+main (void)
+{
+  double r[NLOCI] = { 0.1, 0.2, 0.3 };
+  double W[GENO];
+  double serial[NPOPS][GENO];
+  double threaded[NPOPS][GENO];
+  srand48 (2);
+  for (int i = 0; i < GENO; i++)
+    W[i] = 1.0 + drand48 ();
+  for (int p = 0; p < NPOPS; p++)
+    {
+      double denom = 0.0;
+      for (int i = 0; i < GENO; i++)
+	denom += serial[p][i] = drand48 ();
+      for (int i = 0; i < GENO; i++)
+	threaded[p][i] = serial[p][i] /= denom;
+    }
+
+  haploid_model_t * model = model_new (NLOCI, r);
+  assert ((model != NULL) && (model_refs (model) == 1));
+  haploid_data_t data = model_data (model);
+  assert ((data.geno == GENO) && (data.nloci == NLOCI));
+  assert ((data.mtable == NULL) && (data.rec_packed == NULL));
+  assert (memcmp (model_map (model), r, (NLOCI - 1) * sizeof (double)) == 0);
+
+  /* by hand, with tables of our own */
+  double expect[GENO];
+  memcpy (expect, serial[0], sizeof (expect));
+  haploid_data_t own = { GENO, NLOCI, rec_gen_table (r, GENO) };
+  for (int t = 0; t < GENS; t++)
+    {
+      double wbar = gen_mean (expect, W, GENO);
+      for (int i = 0; i < GENO; i++)
+	expect[i] *= W[i] / wbar;
+      own.mtable = rmtable (expect, GENO);
+      rec_mating (expect, &own);
+      for (int i = 0; i < GENO; i++)
+	free (own.mtable[i]);
+      free (own.mtable);
+    }
+  rec_free_table (own.rec_table, GENO);
+
+  for (int p = 0; p < NPOPS; p++)
+    model_test_run (model, W, serial[p]);
+  assert (model_refs (model) == 1);
+  for (int i = 0; i < GENO; i++)
+    assert (islessequal (fabs (serial[0][i] - expect[i]), 1e-14));
+
+  pthread_t threads[NTHREADS];
+  model_test_arg_t args[NTHREADS];
+  for (int k = 0; k < NTHREADS; k++)
+    {
+      args[k] = (model_test_arg_t) { model_ref (model), W, threaded, k };
+      assert (pthread_create (threads + k, NULL, model_test_thread,
+			      args + k) == 0);
+    }
+  for (int k = 0; k < NTHREADS; k++)
+    assert (pthread_join (threads[k], NULL) == 0);
+  assert (model_refs (model) == 1);
+  assert (memcmp (serial, threaded, sizeof (serial)) == 0);
+#ifdef DEBUG
+  for (int i = 0; i < GENO; i++)
+    fprintf (stdout, "x[%x] = %9.8f\n", i, threaded[0][i]);
+#endif
+
+  model_unref (model);
+  errno = 0;
+  assert ((model_new (0, r) == NULL) && (errno == EINVAL));
+  return 0;
+}
+
+/* end of model_test.c */
@@ -0,0 +1,142 @@
+/*
+
+  packed_test.c: testing recombination tables with a dictionary of values
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   With a packed table in rec_packed, rec_mating () must give exactly
+   the offspring frequencies of the linked table it was packed from,
+   whether the mating table is given by its rows or in one block.
+   Small genomes with one r or several cover 8- and 16-bit codes; a
+   genome of BIGLOCI loci, its table taken from the slices of a lazy
+   table, covers 32-bit positions.  The packed table must also be no
+   larger than mem_estimate () said.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+#include "../src/sparse.h"
+
+#define MAXLOCI 6
+#define BIGLOCI 9
+
+static void
+packed_test (rtable_t ** rtable, size_t nloci, const double * r)
+{
+  size_t geno = 1 << nloci;
+  double freqs[geno];
+  double linked[geno];
+  double denom = 0.0;
+  for (int i = 0; i < geno; i++)
+    denom += freqs[i] = drand48 ();
+  for (int i = 0; i < geno; i++)
+    freqs[i] /= denom;
+
+  haploid_data_t data = { geno, nloci, rtable, rmtable (freqs, geno) };
+  /* skew the mating table away from random mating */
+  for (int i = 0; i < geno; i++)
+    data.mtable[i][i] *= 2.0;
+  /* the linked table itself: rec_mating () would take a kernel of
+     fixed.c for a small genome */
+  for (int k = 0; k < geno; k++)
+    linked[k] = sparse_mat_tot (geno, data.mtable, rtable[k]);
+  data.rec_packed = rec_packed_table (rtable, geno);
+  assert (data.rec_packed != NULL);
+  rec_mating (freqs, &data);
+  for (int k = 0; k < geno; k++)
+    assert (freqs[k] == linked[k]);
+
+  /* the same mating table with its rows in one block */
+  double ** rows = data.mtable;
+  double * block = malloc (geno * geno * sizeof (double));
+  double * mtable[geno];
+  for (int i = 0; i < geno; i++)
+    {
+      mtable[i] = block + i * geno;
+      memcpy (mtable[i], rows[i], geno * sizeof (double));
+    }
+  data.mtable = mtable;
+  rec_mating (freqs, &data);
+  for (int k = 0; k < geno; k++)
+    assert (freqs[k] == linked[k]);
+  data.mtable = rows;
+  free (block);
+
+  /* only the packed table: RTABLE need not come from rec_gen_table */
+  haploid_mem_t est, use;
+  data.rec_table = NULL;
+  mem_estimate (nloci, r, &est);
+  mem_usage (&data, &use);
+#ifdef DEBUG
+  fprintf (stdout, "%zu loci: %zu values, %zu bytes (%zu linked)\n",
+	   nloci, rec_packed_values (data.rec_packed), use.packed,
+	   est.list);
+#endif
+  assert ((use.packed > 0) && (use.packed <= est.packed));
+  rec_packed_free (data.rec_packed);
+  for (int i = 0; i < geno; i++)
+    free (data.mtable[i]);
+  free (data.mtable);
+}
+
+int
+main (void)
+{
+  srand48 (0);
+  for (size_t nloci = 1; nloci <= MAXLOCI; nloci++)
+    for (int same = 0; same < 2; same++)
+      {
+	size_t geno = 1 << nloci;
+	double r[nloci];
+	for (int j = 0; j < nloci; j++)
+	  r[j] = same ? 0.1 : drand48 () / 2.0;
+	rtable_t ** rtable = rec_gen_table (r, geno);
+	packed_test (rtable, nloci, r);
+	rec_free_table (rtable, geno);
+      }
+
+  /* 32-bit positions, without recombination to keep the table small */
+  size_t geno = 1 << BIGLOCI;
+  double r[BIGLOCI] = { 0.0 };
+  rec_lazy_t * lazy = rec_lazy_new (r, geno, 0, REC_LAZY_LRU);
+  rtable_t * rtable[geno];
+  for (uint k = 0; k < geno; k++)
+    rtable[k] = rec_lazy_get (lazy, k);
+  packed_test (rtable, BIGLOCI, r);
+  rec_lazy_free (lazy);
+
+  /* no packed table for a genome this size: */
+  assert (rec_packed_table (NULL, (size_t) 1 << (REC_PACKED_MAXLOCI + 1))
+	  == NULL);
+  return 0;
+}
+
+/* end of packed_test.c */
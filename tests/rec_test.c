@@ -32,14 +32,10 @@
 #include "../src/haploid.h"
 #include "../src/sparse.h"
 #include <time.h>
-#include <signal.h>
 #include <omp.h>
 
-rtable_t ** rec_table;
-haploid_data_t * gdata;
 /* declarations: */
 #define TOL 1e-14
-#define HELL SIGABRT
 void
 rec_test_total (void);
 
@@ -55,14 +51,11 @@ add_rec_entries (double ** sums, rtable_t ** rec_table, size_t geno)
      each table are probabilities and therefore over the sample space
      of mated pairs must add to 1) */
   for (int i = 0; i < geno; i++)
-    {
-      for (int j = 0; j < geno; j++)
-	{
-	  sums[i][j] = 0.0;
-	  for (int k = 0; k < geno; k++)
-	    sums[i][j] += sparse_get_val (rec_table[k], i, j);
-	}
-    }
+    for (int j = 0; j < geno; j++)
+      sums[i][j] = 0.0;
+  for (int k = 0; k < geno; k++)
+    for (rtable_t * elt = rec_table[k]; elt != NULL; elt = elt->next)
+      sums[elt->indices[0]][elt->indices[1]] += elt->val;
 }
 
 int
@@ -86,17 +79,16 @@ check_entries (haploid_data_t * data)
 }
 
 void
-abhandler (int sig)
+rec_test_fail (haploid_data_t * data)
 {
-  check_entries (gdata);
-  signal (sig, SIG_DFL);
-  raise (sig);
+  /* print the sums of the table in DATA, then abort */
+  check_entries (data);
+  abort ();
 }
 
 int
 run_test (size_t nloci, double r)
 {
-  signal (SIGABRT, abhandler);
   size_t geno = 1 << nloci;
   double rarr[nloci];
   double alleles[nloci];
@@ -105,19 +97,28 @@ run_test (size_t nloci, double r)
       rarr[i] = r;
       alleles[i] = 0.5;
     }
-  rec_table = rec_gen_table (nloci, geno, rarr);
+  rtable_t ** rec_table = rec_gen_table (rarr, geno);
   
   double freq[geno];
   allele_to_genotype (alleles, freq, nloci, geno);
   
   haploid_data_t rec_test_data =
-    { geno, nloci, rec_gen_table (nloci, geno, rarr), rmtable (geno, freq)};
+    { geno, nloci, rec_table, rmtable (freq, geno)};
 
 #ifdef DEBUG
   fprintf (stdout, "%zu x %zu x %zu recombination table | r = %f\n", geno, geno, geno, r);
   rec_test_prtable (&rec_test_data);
 #endif  /* DEBUG */
 
+  rec_check_t check;
+  if (rec_validate (rec_table, geno, TOL, &check) != REC_VALID)
+    {
+      fprintf (stdout, "Invalid table: violation %d of %g at offspring %x, "
+	       "parents (%x, %x)\n", check.kind, check.err, check.target,
+	       check.k, check.j);
+      rec_test_fail (&rec_test_data);
+    }
+
   double tot = 0.0F;
   rec_mating (freq, &rec_test_data);
 
@@ -150,18 +151,127 @@ run_test (size_t nloci, double r)
 		   "Starting frequency: p[%1x] = %54.53f\n"
 		   "New frequency: p[%1x] = %54.53f\n",
 		   j, alleles[j], j, alleles_new[j]);
-	  gdata = &rec_test_data;
-	  raise (HELL);
+	  rec_test_fail (&rec_test_data);
 	}
     }
+  for (int i = 0; i < geno; i++)
+    free (rec_test_data.mtable[i]);
+  free (rec_test_data.mtable);
+  rec_free_table (rec_table, geno);
   return 0;
 }
 
+rtable_t *
+rec_test_find (rtable_t ** rtable, uint target, uint k, uint j)
+{
+  /* the entry for parents K and J in the table of TARGET */
+  for (rtable_t * elt = rtable[target]; elt != NULL; elt = elt->next)
+    if ((elt->indices[0] == k) && (elt->indices[1] == j))
+      return elt;
+  return NULL;
+}
+
+double
+rec_test_brute (uint k, uint j, uint target, double * r, size_t nloci)
+{
+  /* the probability that parents K and J have offspring TARGET, by
+     summing over the segregation masks: bit t of M is set when locus
+     t comes from J; interval t - 1 switches parents with probability
+     R[t - 1] */
+  uint geno = 1U << nloci;
+  double tot = 0.0;
+  for (uint m = 0; m < geno; m++)
+    {
+      if ((((j & m) | (k & ~m)) & (geno - 1)) != target)
+	continue;
+      double p = 0.5;
+      for (size_t t = 1; t < nloci; t++)
+	p *= (((m >> t) ^ (m >> (t - 1))) & 1) ? r[t - 1] : 1.0 - r[t - 1];
+      tot += p;
+    }
+  return tot;
+}
+
+void
+rec_test_unequal (size_t nloci)
+{
+  /* compare every entry of a table with unequal rates to the sum
+     over segregation masks; a walk that lost track of which parent
+     supplied the last locus was off by 0.05 at three loci */
+  double r[3] = { 0.1, 0.3, 0.45 };
+  uint geno = 1U << nloci;
+  rtable_t ** rtable = rec_gen_table (r, geno);
+  for (uint target = 0; target < geno; target++)
+    for (uint k = 0; k < geno; k++)
+      for (uint j = 0; j < geno; j++)
+	{
+	  double val = sparse_get_val (rtable[target], k, j);
+	  double want = rec_test_brute (k, j, target, r, nloci);
+#ifdef DEBUG
+	  if (fabs (val - want) > TOL)
+	    fprintf (stdout, "%zu loci: parents (%x, %x) -> %x: %g, not %g\n",
+		     nloci, k, j, target, val, want);
+#endif	/* DEBUG */
+	  assert (fabs (val - want) <= TOL);
+	}
+  rec_free_table (rtable, geno);
+}
+
+void
+rec_test_corrupt (void)
+{
+  /* break a two-locus table each way rec_validate () looks for; the
+     offspring of 0 and 3 are 0 and 3 with probability (1 - r) / 2
+     each and 1 and 2 with probability r / 2 */
+  double r[2] = { 0.1 };
+  rec_check_t check;
+  rtable_t ** rtable;
+
+  /* pair (0, 0) sums to one half */
+  rtable = rec_gen_table (r, 4);
+  rec_test_find (rtable, 0, 0, 0)->val = 0.5;
+  assert (rec_validate (rtable, 4, TOL, &check) == REC_BAD_SUM);
+  assert ((check.k == 0) && (check.j == 0) && (check.nbad == 1));
+  assert (fabs (check.err - 0.5) < TOL);
+  rec_free_table (rtable, 4);
+
+  /* an index out of range outweighs everything */
+  rtable = rec_gen_table (r, 4);
+  rec_test_find (rtable, 1, 0, 3)->indices[1] = 4;
+  assert (rec_validate (rtable, 4, TOL, &check) == REC_BAD_INDEX);
+  assert ((check.target == 1) && isinf (check.err));
+  rec_free_table (rtable, 4);
+
+  /* mass moved between offspring keeps the sums but not symmetry */
+  rtable = rec_gen_table (r, 4);
+  rec_test_find (rtable, 1, 0, 3)->val -= 0.01;
+  rec_test_find (rtable, 2, 0, 3)->val += 0.01;
+  assert (rec_validate (rtable, 4, 1e-12, &check) == REC_BAD_SYMMETRY);
+  assert ((check.nbad == 2) && (fabs (check.err - 0.01) < 1e-12));
+  rec_free_table (rtable, 4);
+
+  /* and moved symmetrically, too much of it leaves a negative */
+  rtable = rec_gen_table (r, 4);
+  for (int t = 0; t < 2; t++)
+    {
+      rec_test_find (rtable, 1, t ? 3 : 0, t ? 0 : 3)->val -= 0.06;
+      rec_test_find (rtable, 2, t ? 3 : 0, t ? 0 : 3)->val += 0.06;
+    }
+  assert (rec_validate (rtable, 4, 1e-12, &check) == REC_BAD_NEGATIVE);
+  assert ((check.target == 1) && (check.nbad == 2));
+  assert (fabs (check.err - 0.01) < 1e-12);
+  rec_free_table (rtable, 4);
+}
+
 int
 main (void)
 {
-  for (int i = 0; i < 0xf; i++)
+  /* eager tables take about 8^nloci steps to build */
+  for (int i = 1; i <= 6; i++)
     for (double r = 0.0F; r < 0.6; r += 0.1)
       run_test (i, r);
+  for (int i = 2; i <= 4; i++)
+    rec_test_unequal (i);
+  rec_test_corrupt ();
   return 0;
 }
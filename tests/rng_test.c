@@ -0,0 +1,113 @@
+/*
+
+  rng_test.c: testing the counter-based random number streams
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Check the Philox4x32-10 block function against the known-answer
+   vectors of Salmon et al. (2011).  Then check that a stream depends
+   only on its name: the bulk fills return what single draws would, a
+   restarted stream repeats itself, and streams differing only in run,
+   trial or thread differ.  Finally the uniforms should have mean one
+   half.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define DRAWS 100000
+#define LEN 1001
+
+int
+main (void)
+{
+  static const uint32_t kat[3][10] =
+    {
+      { 0, 0, 0, 0, 0, 0,
+	0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+      { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	0xffffffff, 0xffffffff,
+	0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+      { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
+	0xa4093822, 0x299f31d0,
+	0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+    };
+  for (int v = 0; v < 3; v++)
+    {
+      uint32_t out[4];
+      rng_philox (kat[v], kat[v] + 4, out);
+      assert (memcmp (out, kat[v] + 6, sizeof (out)) == 0);
+    }
+
+  /* bulk fills are single draws, whatever the starting offset */
+  haploid_rng_t a, b;
+  uint32_t words[LEN];
+  rng_init (&a, 42, 1, 2, 3);
+  rng_init (&b, 42, 1, 2, 3);
+  rng_u32 (&a);
+  rng_u32 (&b);
+  rng_fill_u32 (&a, words, LEN);
+  for (int i = 0; i < LEN; i++)
+    assert (words[i] == rng_u32 (&b));
+  double u[LEN];
+  rng_fill_uniform (&a, u, LEN);
+  for (int i = 0; i < LEN; i++)
+    assert (u[i] == rng_uniform (&b));
+
+  /* a restarted stream repeats; other streams do not */
+  rng_init (&a, 42, 1, 2, 3);
+  uint32_t first = rng_u32 (&a);
+  rng_init (&a, 42, 1, 2, 3);
+  assert (rng_u32 (&a) == first);
+  rng_init (&a, 43, 1, 2, 3);
+  assert (rng_u32 (&a) != first);
+  rng_init (&a, 42, 0, 2, 3);
+  assert (rng_u32 (&a) != first);
+  rng_init (&a, 42, 1, 0, 3);
+  assert (rng_u32 (&a) != first);
+  rng_init (&a, 42, 1, 2, 0);
+  assert (rng_u32 (&a) != first);
+
+  double sum = 0.0;
+  for (int d = 0; d < DRAWS; d++)
+    {
+      double x = rng_uniform (&a);
+      assert ((x >= 0.0) && (x < 1.0));
+      sum += x;
+    }
+#ifdef DEBUG
+  fprintf (stdout, "mean = %f\n", sum / DRAWS);
+#endif
+  /* six standard errors */
+  assert (fabs (sum / DRAWS - 0.5) < 6.0 * sqrt (1.0 / 12.0 / DRAWS));
+  return 0;
+}
+/* end of rng_test.c */
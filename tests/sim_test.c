@@ -0,0 +1,145 @@
+/*
+
+  sim_test.c: testing simulations that run for a budget and resume
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Run NSIMS simulations under selection each to the end, then again
+   in turns of a few generations: the two must agree to the bit.
+   Without selection and from linkage equilibrium a simulation
+   converges at once; with linkage disequilibrium and no tolerance it
+   never does, and only its budget stops it.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 3
+#define GENO 8
+#define NSIMS 6
+#define TURN 7
+#define TOL 1e-9
+
+static void
+sim_test_count (const haploid_sim_t * sim, void * arg)
+{
+  (* (int *) arg)++;
+}
+
+int
+main (void)
+{
+  double r[NLOCI] = { 0.1, 0.4 };
+  double W[GENO];
+  double init[NSIMS][GENO];
+  srand48 (3);
+  for (int i = 0; i < GENO; i++)
+    W[i] = 1.0 + 0.05 * bits_popcount (i);
+  for (int s = 0; s < NSIMS; s++)
+    {
+      double denom = 0.0;
+      for (int i = 0; i < GENO; i++)
+	denom += init[s][i] = drand48 ();
+      for (int i = 0; i < GENO; i++)
+	init[s][i] /= denom;
+    }
+  haploid_model_t * model = model_new (NLOCI, r);
+
+  /* each to the end */
+  haploid_sim_t * sims[NSIMS];
+  double end[NSIMS][GENO];
+  uint64_t gens[NSIMS];
+  for (int s = 0; s < NSIMS; s++)
+    {
+      haploid_sim_t * sim = sim_new (model, init[s], W, TOL);
+      int seen = 0;
+      sim->observe = sim_test_count;
+      sim->arg = &seen;
+      assert (sim_run_for (sim, 0, 0.0) == SIM_FIXED);
+      assert (seen == sim->gens);
+      assert (isgreaterequal (sim->pop->freqs[GENO - 1], 1.0 - sqrt (TOL)));
+      memcpy (end[s], sim->pop->freqs, sizeof (end[s]));
+      gens[s] = sim->gens;
+      /* a finished simulation stays finished */
+      assert (sim_run_for (sim, 1, 0.0) == SIM_FIXED);
+      assert (sim->gens == gens[s]);
+      sim_free (sim);
+    }
+
+  /* in turns */
+  for (int s = 0; s < NSIMS; s++)
+    sims[s] = sim_new (model, init[s], W, TOL);
+  int running = NSIMS;
+  int turns = 0;
+  while (running > 0)
+    {
+      running = 0;
+      for (int s = 0; s < NSIMS; s++)
+	if (sim_run_for (sims[s], TURN, 0.0) == SIM_BUDGET)
+	  {
+	    assert (sims[s]->gens % TURN == 0);
+	    running++;
+	  }
+      turns++;
+    }
+#ifdef DEBUG
+  fprintf (stdout, "%d turns of %d generations\n", turns, TURN);
+#endif
+  assert (turns > 1);
+  for (int s = 0; s < NSIMS; s++)
+    {
+      assert (sims[s]->gens == gens[s]);
+      assert (memcmp (sims[s]->pop->freqs, end[s], sizeof (end[s])) == 0);
+      sim_free (sims[s]);
+    }
+
+  /* linkage equilibrium is already an equilibrium */
+  double alleles[NLOCI] = { 0.2, 0.5, 0.7 };
+  double eq[GENO];
+  allele_to_genotype (alleles, eq, NLOCI, GENO);
+  haploid_sim_t * sim = sim_new (model, eq, NULL, TOL);
+  assert ((sim_run_for (sim, 0, 0.0) == SIM_CONVERGED) && (sim->gens == 1));
+  sim_free (sim);
+
+  /* with no tolerance only the budget ends it */
+  sim = sim_new (model, init[0], NULL, 0.0);
+  assert ((sim_run_for (sim, 1, 0.0) == SIM_BUDGET) && (sim->gens == 1));
+  assert (sim_run_for (sim, 0, 0.01) == SIM_BUDGET);
+  uint64_t n = sim->gens;
+  assert (n > 1);
+  assert ((sim_run_for (sim, 0, 1e-9) == SIM_BUDGET) && (sim->gens == n + 1));
+  sim_free (sim);
+
+  model_unref (model);
+  return 0;
+}
+
+/* end of sim_test.c */
@@ -0,0 +1,144 @@
+/*
+
+  spop_test.c: testing sparse populations
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Without pruning, one round of spop_recombine () must give the same
+   frequencies as rec_mating () with a random mating table, and
+   spop_mutate () the same as mutating a dense array locus by locus.
+   Then run a population founded from two complementary 60-locus
+   haplotypes for a few generations: allele frequencies must stay at
+   one half up to the mass lost to pruning.  Finally, found a
+   population from many haplotypes added out of order, some of them
+   twice.
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 5
+#define GENO 32
+#define BIGLOCI 60
+#define TOL 1e-12
+
+static double
+spop_test_fitness (uint64_t id, void * arg)
+{
+  return 1.0 + (id & 1);
+}
+
+int
+main (void)
+{
+  double freqs[GENO];
+  double dense[GENO];
+  double r[NLOCI];
+  double mu[NLOCI];
+  double denom = 0.0;
+  srand48 (0);
+  for (int i = 0; i < GENO; i++)
+    denom += freqs[i] = drand48 ();
+  for (int i = 0; i < GENO; i++)
+    freqs[i] /= denom;
+  for (int j = 0; j < NLOCI; j++)
+    {
+      r[j] = drand48 () / 2.0;
+      mu[j] = drand48 () / 100.0;
+    }
+
+  /* recombination */
+  spop_t * pop = spop_from_dense (freqs, GENO);
+  assert (spop_recombine (pop, r, 0.0) == 0.0);
+  haploid_data_t data = { GENO, NLOCI, rec_gen_table (r, GENO),
+			  rmtable (freqs, GENO) };
+  rec_mating (dense, &data);
+  for (int i = 0; i < GENO; i++)
+    assert (islessequal (fabs (spop_get (pop, i) - dense[i]), TOL));
+
+  /* mutation */
+  spop_mutate (pop, mu, 0.0);
+  for (int j = 0; j < NLOCI; j++)
+    {
+      double next[GENO];
+      for (int i = 0; i < GENO; i++)
+	next[i] = (1.0 - mu[j]) * dense[i] + mu[j] * dense[i ^ (1 << j)];
+      for (int i = 0; i < GENO; i++)
+	dense[i] = next[i];
+    }
+  spop_to_dense (pop, freqs, GENO);
+  for (int i = 0; i < GENO; i++)
+    assert (islessequal (fabs (freqs[i] - dense[i]), TOL));
+
+  /* selection */
+  spop_select (pop, spop_test_fitness, NULL);
+  double total = 0.0;
+  for (size_t i = 0; i < pop->n; i++)
+    total += pop->elts[i].freq;
+  assert (islessequal (fabs (total - 1.0), TOL));
+  spop_free (pop);
+
+  /* many loci */
+  double bigr[BIGLOCI];
+  for (int j = 0; j < BIGLOCI; j++)
+    bigr[j] = 0.001;
+  pop = spop_new (BIGLOCI);
+  spop_add (pop, 0, 0.5);
+  spop_add (pop, (UINT64_C(1) << BIGLOCI) - 1, 0.5);
+  double dropped = 0.0;
+  for (int gen = 0; gen < 2; gen++)
+    dropped += spop_recombine (pop, bigr, 1e-6);
+#ifdef DEBUG
+  fprintf (stdout, "%zu haplotypes, %g dropped\n", pop->n, dropped);
+#endif
+  assert (pop->n > 2);
+  for (int j = 0; j < BIGLOCI; j++)
+    {
+      double p = 0.0;
+      for (size_t i = 0; i < pop->n; i++)
+	if ((pop->elts[i].id >> j) & 1)
+	  p += pop->elts[i].freq;
+      assert (islessequal (fabs (p - 0.5), dropped + TOL));
+    }
+  spop_free (pop);
+
+  /* founding: 4096 additions to 1024 haplotypes, in a scrambled
+     order */
+  pop = spop_new (BIGLOCI);
+  for (uint64_t i = 0; i < 4096; i++)
+    spop_add (pop, ((i * 617) % 1024) << 40, 1.0 / 4096);
+  assert (!pop->sorted);
+  for (uint64_t i = 0; i < 1024; i++)
+    assert (fabs (spop_get (pop, i << 40) - 1.0 / 1024) <= TOL);
+  assert (pop->sorted && (pop->n == 1024));
+  spop_free (pop);
+  return 0;
+}
+/* end of spop_test.c */
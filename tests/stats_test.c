@@ -0,0 +1,156 @@
+/*
+
+  stats_test.c: testing the counters, stage timers and trace output
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Run a few generations of the deterministic recursion and check the
+   totals: with --enable-stats every counter and stage must have seen
+   exactly the work done, a second thread's totals must survive its
+   exit, and the trace must be a complete JSON document; without it,
+   everything reads as zero and no trace can be opened.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include "../src/haploid.h"
+
+#define NLOCI 3
+#define GENO 8
+#define GENS 5
+#define TRACE "stats_test.json"
+
+static void *
+stats_test_thread (void * arg)
+{
+  /* count some work on another thread */
+  double * r = arg;
+  rec_free_table (rec_gen_table (r, GENO), GENO);
+  return NULL;
+}
+
+int
+main (void)
+{
+  haploid_stats_t stats;
+  double freqs[GENO];
+  double r[NLOCI] = { 0.1, 0.2, 0.3 };
+  for (int i = 0; i < GENO; i++)
+    freqs[i] = 1.0 / GENO;
+
+  stats_reset ();
+  if (stats_enabled ())
+    assert (stats_trace_open (TRACE) == 0);
+  haploid_data_t data = { GENO, NLOCI, rec_gen_table (r, GENO),
+			  NULL, NULL };
+  for (int t = 0; t < GENS; t++)
+    {
+      data.mtable = rmtable (freqs, GENO);
+      rec_mating (freqs, &data);
+      for (int i = 0; i < GENO; i++)
+	free (data.mtable[i]);
+      free (data.mtable);
+    }
+  stats_get (&stats);
+#ifdef DEBUG
+  for (int c = 0; c < STATS_NCOUNTERS; c++)
+    fprintf (stdout, "count[%d] = %lu\n", c, (unsigned long) stats.count[c]);
+  for (int s = 0; s < STATS_NSTAGES; s++)
+    fprintf (stdout, "%s: %lu calls, %lu ns\n", stats_stage_name (s),
+	     (unsigned long) stats.stage_calls[s],
+	     (unsigned long) stats.stage_ns[s]);
+#endif
+  assert (stats_stage_name (STATS_NSTAGES) == NULL);
+
+  if (!stats_enabled ())
+    {
+      for (int c = 0; c < STATS_NCOUNTERS; c++)
+	assert (stats.count[c] == 0);
+      for (int s = 0; s < STATS_NSTAGES; s++)
+	assert ((stats.stage_calls[s] == 0) && (stats.stage_ns[s] == 0));
+      errno = 0;
+      assert ((stats_trace_open (TRACE) == -1) && (errno == ENOSYS));
+      assert (stats_trace_close () == 0);
+      return 0;
+    }
+
+  /* one table, GENS mating tables and GENS generations, which the
+     kernel of fixed.c for NLOCI loci runs without the table */
+  uint64_t nnz = stats.count[STATS_TABLE_NNZ];
+  assert (nnz > 0);
+  assert (stats.count[STATS_GENERATIONS] == GENS);
+  assert (stats.count[STATS_MAT_TOT] == 0);
+  assert (stats.count[STATS_ALLOCS] >= GENS * (GENO + 1));
+  assert (stats.stage_calls[STATS_STAGE_TABLE] == 1);
+  assert (stats.stage_calls[STATS_STAGE_MTABLE] == GENS);
+  assert (stats.stage_calls[STATS_STAGE_RECOMB] == GENS);
+  assert (stats.stage_calls[STATS_STAGE_SELECT] == 0);
+
+  /* a stage timed by the caller */
+  stats_begin (STATS_STAGE_USER);
+  stats_end (STATS_STAGE_USER);
+  stats_get_thread (&stats);
+  assert (stats.stage_calls[STATS_STAGE_USER] == 1);
+
+  /* another thread's totals outlive it */
+  pthread_t thread;
+  assert (pthread_create (&thread, NULL, stats_test_thread, r) == 0);
+  assert (pthread_join (thread, NULL) == 0);
+  stats_get_thread (&stats);
+  assert (stats.count[STATS_TABLE_NNZ] == nnz);
+  stats_get (&stats);
+  assert (stats.count[STATS_TABLE_NNZ] == 2 * nnz);
+  assert (stats.stage_calls[STATS_STAGE_TABLE] == 2);
+
+  /* only one trace at a time */
+  errno = 0;
+  assert ((stats_trace_open (TRACE) == -1) && (errno == EBUSY));
+  assert (stats_trace_close () == 0);
+  FILE * f = fopen (TRACE, "r");
+  assert (f != NULL);
+  char buf[1 << 16];
+  size_t len = fread (buf, 1, sizeof (buf) - 1, f);
+  fclose (f);
+  buf[len] = '\0';
+  assert (strncmp (buf, "{\"traceEvents\":[", 16) == 0);
+  assert (strcmp (buf + len - 2, "}\n") == 0);
+  assert (strstr (buf, "\"name\":\"rec_mating\"") != NULL);
+  assert (strstr (buf, "\"name\":\"user\"") != NULL);
+  remove (TRACE);
+
+  stats_reset ();
+  stats_get (&stats);
+  assert (stats.count[STATS_GENERATIONS] == 0);
+  return 0;
+}
+
+/* end of stats_test.c */
@@ -0,0 +1,92 @@
+/*
+
+  summary_test.c: testing the fused population summary
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   haploid_summarize () should give the same numbers as the separate
+   calls it replaces: genotype_to_allele (), ld_sub_geno (), gen_mean ()
+   and the distance used by sim_stop_ck ().
+
+*/
+#include <stdio.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 10
+#define GENO 1024
+#define NLD 4
+#define TOL 1e-12
+
+int
+main (void)
+{
+  double freqs[GENO];
+  double prev[GENO];
+  double W[GENO];
+  double denom = 0.0;
+  srand48 (0);
+  for (int i = 0; i < GENO; i++)
+    {
+      denom += freqs[i] = drand48 ();
+      prev[i] = drand48 () / GENO;
+      W[i] = 1.0 + drand48 ();
+    }
+  for (int i = 0; i < GENO; i++)
+    freqs[i] /= denom;
+
+  double alleles[NLOCI];
+  double ld[NLD];
+  uint masks[NLD] = { 0x3, 0x201, 0x7, 0x3f0 };
+  haploid_summary_t summary = { alleles };
+  summary.nld = NLD;
+  summary.ld_masks = masks;
+  summary.ld = ld;
+  haploid_summarize (freqs, prev, W, GENO, &summary);
+
+  double hand[NLOCI];
+  genotype_to_allele (hand, freqs, NLOCI, GENO);
+  for (int j = 0; j < NLOCI; j++)
+    assert (islessequal (fabs (alleles[j] - hand[j]), TOL));
+  for (int q = 0; q < NLD; q++)
+    assert (islessequal (fabs (ld[q] - ld_sub_geno (freqs, masks[q], GENO)),
+			 TOL));
+  assert (islessequal (fabs (summary.wbar - gen_mean (freqs, W, GENO)), TOL));
+  assert (islessequal (fabs (summary.drift), TOL));
+  double dist = 0.0;
+  for (int i = 0; i < GENO; i++)
+    dist += (freqs[i] - prev[i]) * (freqs[i] - prev[i]);
+  assert (islessequal (fabs (summary.dist - sqrt (dist)), TOL));
+
+  /* without a previous generation or fitnesses: */
+  haploid_summarize (freqs, NULL, NULL, GENO, &summary);
+  assert (isnan (summary.wbar) && isnan (summary.dist));
+  return 0;
+}
+/* end of summary_test.c */
@@ -0,0 +1,183 @@
+/*
+
+  traj_test.c: testing binary trajectory files
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Run selection and recombination for a few hundred generations and
+   save the trajectory three ways: every generation, decimated, and
+   XOR-compressed.  Mapping each file back must give the header, the
+   parameters and exactly the records that were kept, and the
+   compressed file must be smaller.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "../src/haploid.h"
+
+#define NLOCI 3
+#define GENO 8
+#define GENS 300
+#define EVERY 50
+#define THRESHOLD 0.01
+#define SEED 12345
+
+static size_t
+traj_test_file (char * path, traj_info_t * info, double (*traj)[GENO])
+{
+  /* write TRAJ to a new temporary file PATH; return its size */
+  int fd = mkstemp (path);
+  assert (fd >= 0);
+  haploid_writer_t * w = writer_new (fd, 0);
+  traj_t * t = traj_open (w, info);
+  assert (t != NULL);
+  for (int g = 0; g < GENS; g++)
+    assert (traj_record (t, g, traj[g]) >= 0);
+  assert (traj_final (t, GENS - 1, traj[GENS - 1]) >= 0);
+  assert (traj_close (t) == 0);
+  assert (writer_free (w) == 0);
+  off_t size = lseek (fd, 0, SEEK_END);
+  close (fd);
+  return size;
+}
+
+static void
+traj_test_check (char * path, traj_info_t * info, double (*traj)[GENO],
+		 size_t expect)
+{
+  /* compare the file at PATH with TRAJ, expecting EXPECT records */
+  traj_map_t * map = traj_map (path);
+  assert (map != NULL);
+  assert (map->header->nloci == NLOCI);
+  assert (map->header->geno == GENO);
+  assert (map->header->seed == SEED);
+  assert (map->header->every == info->every);
+  assert (memcmp (map->r, info->r, (NLOCI - 1) * sizeof (double)) == 0);
+  assert (memcmp (map->W, info->W, GENO * sizeof (double)) == 0);
+  assert (map->nrec == expect);
+  uint64_t last = 0;
+  for (size_t i = 0; i < map->nrec; i++)
+    {
+      uint64_t gen;
+      const double * freqs = traj_get (map, i, &gen);
+      assert (gen < GENS);
+      assert ((i == 0) || (gen > last));
+      assert (memcmp (freqs, traj[gen], GENO * sizeof (double)) == 0);
+      last = gen;
+    }
+  assert (last == GENS - 1);
+  traj_unmap (map);
+  unlink (path);
+}
+
+int
+main (void)
+{
+  static double traj[GENS][GENO];
+  double r[NLOCI - 1] = { 0.1, 0.2 };
+  double W[GENO];
+  srand48 (0);
+  double denom = 0.0;
+  for (int i = 0; i < GENO; i++)
+    {
+      W[i] = 1.0 + 0.1 * drand48 ();
+      denom += traj[0][i] = drand48 ();
+    }
+  for (int i = 0; i < GENO; i++)
+    traj[0][i] /= denom;
+  haploid_data_t data = { GENO, NLOCI, rec_gen_table (r, GENO), NULL };
+  for (int g = 1; g < GENS; g++)
+    {
+      double * freqs = traj[g];
+      double wbar = 0.0;
+      for (int i = 0; i < GENO; i++)
+	wbar += traj[g - 1][i] * W[i];
+      for (int i = 0; i < GENO; i++)
+	freqs[i] = traj[g - 1][i] * W[i] / wbar;
+      data.mtable = rmtable (freqs, GENO);
+      rec_mating (freqs, &data);
+    }
+
+  /* every generation */
+  traj_info_t info = { NLOCI, GENO, TRAJ_FITNESS, 0, 0.0, SEED, r, W };
+  char plain[] = "traj_testXXXXXX";
+  size_t plain_size = traj_test_file (plain, &info, traj);
+  traj_test_check (plain, &info, traj, GENS);
+
+  /* decimated: count what should be kept */
+  size_t kept = 1;
+  int last = 0;
+  for (int g = 1; g < GENS; g++)
+    {
+      _Bool keep = (g % EVERY == 0);
+      for (int i = 0; i < GENO; i++)
+	keep = keep || (fabs (traj[g][i] - traj[last][i]) > THRESHOLD);
+      if (keep)
+	{
+	  kept++;
+	  last = g;
+	}
+    }
+  if (last != GENS - 1)
+    kept++;
+#ifdef DEBUG
+  fprintf (stdout, "%zu of %d generations kept\n", kept, GENS);
+#endif
+  assert (kept < GENS);
+  info.every = EVERY;
+  info.threshold = THRESHOLD;
+  char decimated[] = "traj_testXXXXXX";
+  traj_test_file (decimated, &info, traj);
+  traj_test_check (decimated, &info, traj, kept);
+
+  /* compressed */
+  info.flags |= TRAJ_XOR;
+  info.every = 0;
+  info.threshold = 0.0;
+  char xor[] = "traj_testXXXXXX";
+  size_t xor_size = traj_test_file (xor, &info, traj);
+#ifdef DEBUG
+  fprintf (stdout, "%zu bytes plain, %zu compressed\n", plain_size,
+	   xor_size);
+#endif
+  assert (xor_size < plain_size);
+  traj_test_check (xor, &info, traj, GENS);
+
+  /* not a trajectory */
+  info.geno = GENO + 1;
+  assert (traj_open (NULL, &info) == NULL);
+  /* too many loci for the header */
+  info.nloci = 32;
+  info.geno = (size_t) 1 << 32;
+  assert ((traj_open (NULL, &info) == NULL) && (errno == EINVAL));
+  return 0;
+}
+/* end of traj_test.c */
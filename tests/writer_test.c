@@ -0,0 +1,118 @@
+/*
+
+  writer_test.c: testing the buffered writer
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   writer_fixed () must print exactly what printf does, for random
+   doubles of many magnitudes, for exact ties (which go to even) and
+   for negative zero.  Write everything through a writer with a small
+   buffer, so it flushes often, and compare the file with the same
+   output from snprintf ().
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define DRAWS 100000
+#define BUFSIZE 100
+
+int
+main (void)
+{
+  static const double special[] =
+    {
+      0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.375, -0.125, 1e-9, -1e-9,
+      0.999999995, 0.123456785, 1e15, 4.5e15, 1e300, INFINITY, -INFINITY
+    };
+  size_t nspecial = sizeof (special) / sizeof (double);
+  FILE * file = tmpfile ();
+  assert (file != NULL);
+  haploid_writer_t * w = writer_new (fileno (file), BUFSIZE);
+  char * expect = NULL;
+  size_t expect_len = 0;
+  FILE * mem = open_memstream (&expect, &expect_len);
+
+  srand48 (0);
+  for (size_t d = 0; d < DRAWS + nspecial; d++)
+    {
+      double x;
+      if (d < nspecial)
+	x = special[d];
+      else
+	x = (drand48 () - 0.5) * pow (10.0, floor (drand48 () * 24.0) - 12.0);
+      int prec = d % (WRITER_MAXPREC + 1);
+      int width = d % 23;
+      _Bool left = d & 1;
+      assert (writer_fixed (w, x, width, prec, left) == 0);
+      fprintf (mem, left ? "%-*.*f" : "%*.*f", width, prec, x);
+      /* the format used by the examples */
+      assert (writer_fixed (w, x, 9, 8, true) == 0);
+      assert (writer_char (w, ' ') == 0);
+      fprintf (mem, "%-#9.8f ", x);
+      if (d % 100 == 0)
+	{
+	  assert (writer_printf (w, "Trial %zu\n", d) == 0);
+	  fprintf (mem, "Trial %zu\n", d);
+	}
+    }
+  /* longer than the buffer */
+  char big[3 * BUFSIZE];
+  memset (big, 'x', sizeof (big));
+  big[sizeof (big) - 1] = '\0';
+  assert (writer_printf (w, "%s\n", big) == 0);
+  fprintf (mem, "%s\n", big);
+  assert (writer_str (w, big) == 0);
+  fputs (big, mem);
+  assert (writer_free (w) == 0);
+  fclose (mem);
+
+  /* compare */
+  fflush (file);
+  assert (ftell (file) == (long) expect_len);
+  rewind (file);
+  char * got = malloc (expect_len);
+  assert (fread (got, 1, expect_len, file) == expect_len);
+  for (size_t i = 0; i < expect_len; i++)
+    {
+#ifdef DEBUG
+      if (got[i] != expect[i])
+	fprintf (stdout, "at %zu: %.40s\n    vs %.40s\n", i, got + i,
+		 expect + i);
+#endif
+      assert (got[i] == expect[i]);
+    }
+  free (got);
+  free (expect);
+  fclose (file);
+  return 0;
+}
+/* end of writer_test.c */
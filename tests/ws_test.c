@@ -0,0 +1,165 @@
+/*
+
+  ws_test.c: testing generations that allocate nothing
+
+  Copyright 2026 Joel J. Adamson
+
+  $Id$
+
+  Joel J. Adamson -- http://www.unc.edu/~adamsonj
+  University of North Carolina at Chapel Hill
+  CB #3280, Coker Hall
+  Chapel Hill, NC 27599-3280 <adamsonj@email.unc.edu>
+
+  This file is part of haploid
+
+  haploid is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  haploid is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with haploid.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Commentary:
+
+   Run generations through a workspace, with the linked, flattened
+   and packed tables, and check that they give what rmtable () and
+   geno_marginals () give, to the bit, while the allocator, counted by
+   wrapping it here, is never called.
+
+*/
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../src/haploid.h"
+
+#define NLOCI 5
+#define GENO 32
+#define GENS 10
+
+/* the GNU C Library's own allocator, under the wrappers below */
+extern void * __libc_malloc (size_t size);
+extern void * __libc_calloc (size_t n, size_t size);
+extern void * __libc_realloc (void * ptr, size_t size);
+
+static size_t ws_test_allocs = 0;
+
+void *
+malloc (size_t size)
+{
+  ws_test_allocs++;
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  ws_test_allocs++;
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void * ptr, size_t size)
+{
+  ws_test_allocs++;
+  return __libc_realloc (ptr, size);
+}
+
+static void
+ws_test_select (double * freqs, const double * W)
+{
+  double wbar = gen_mean (freqs, (double *) W, GENO);
+  for (int i = 0; i < GENO; i++)
+    freqs[i] *= W[i] / wbar;
+}
+
+int
+main (void)
+{
+  double r[NLOCI] = { 0.1, 0.2, 0.3, 0.4 };
+  double W[GENO];
+  double init[GENO];
+  double denom = 0.0;
+  srand48 (1);
+  for (int i = 0; i < GENO; i++)
+    {
+      denom += init[i] = drand48 ();
+      W[i] = 1.0 + drand48 ();
+    }
+  for (int i = 0; i < GENO; i++)
+    init[i] /= denom;
+
+  rtable_t ** rtable = rec_gen_table (r, GENO);
+  haploid_ws_t * ws = ws_new (NLOCI);
+  assert ((ws != NULL) && (ws->geno == GENO));
+  /* the map kept in the table, a map of our own and a packed table in
+     turn */
+  haploid_data_t data[3] = {
+    { GENO, NLOCI, rtable },
+    { GENO, NLOCI, rtable, NULL, rec_fixed_table (r, GENO) },
+    { GENO, NLOCI, rtable, NULL, NULL, NULL,
+      rec_packed_table (rtable, GENO) }
+  };
+  assert ((data[1].rec_fixed != NULL) && (data[2].rec_packed != NULL));
+
+  uint masks[2] = { 0x3, 0x14 };
+  double m0[4], m1[4], w0[4], w1[4];
+  double * heap[2] = { m0, m1 };
+  double * fromws[2] = { w0, w1 };
+  for (int d = 0; d < 3; d++)
+    {
+      double expect[GENO];
+      double freqs[GENO];
+      memcpy (expect, init, sizeof (init));
+      memcpy (freqs, init, sizeof (init));
+      size_t before = ws_test_allocs;
+      size_t heapallocs = 0;
+      for (int t = 0; t < GENS; t++)
+	{
+	  /* the allocating calls, not counted */
+	  ws_test_select (expect, W);
+	  size_t n = ws_test_allocs;
+	  data[d].mtable = rmtable (expect, GENO);
+	  rec_mating (expect, data + d);
+	  for (int i = 0; i < GENO; i++)
+	    free (data[d].mtable[i]);
+	  free (data[d].mtable);
+	  geno_marginals (expect, GENO, masks, 2, heap);
+	  heapallocs += ws_test_allocs - n;
+
+	  ws_test_select (freqs, W);
+	  data[d].mtable = rmtable_ws (freqs, ws);
+	  assert (data[d].mtable == ws->mtable);
+	  rec_mating (freqs, data + d);
+	  geno_marginals_ws (freqs, masks, 2, fromws, ws);
+	  assert (memcmp (freqs, expect, sizeof (freqs)) == 0);
+	  assert (memcmp (m0, w0, sizeof (m0)) == 0);
+	  assert (memcmp (m1, w1, sizeof (m1)) == 0);
+	}
+      size_t wsallocs = ws_test_allocs - before - heapallocs;
+#ifdef DEBUG
+      fprintf (stdout, "table %d: %zu allocations without a workspace, "
+	       "%zu with\n", d, heapallocs, wsallocs);
+#endif
+      assert ((heapallocs > 0) && (wsallocs == 0));
+    }
+
+  errno = 0;
+  assert ((ws_new (0) == NULL) && (errno == EINVAL));
+  ws_free (ws);
+  ws_free (NULL);
+  rec_fixed_free (data[1].rec_fixed);
+  rec_packed_free (data[2].rec_packed);
+  rec_free_table (rtable, GENO);
+  return 0;
+}
+
+/* end of ws_test.c */